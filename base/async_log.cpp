@@ -0,0 +1,663 @@
+#include <thread>
+#include "async_log.h"
+#include "log.h"
+#include "time_helper.h"
+
+//ǰ̵߳Ļλ,߳˳ʱر,֮ͷ
+struct CLogRingHolder
+{
+	CLogRing*	m_pRing;
+	CLogRingHolder() : m_pRing(NULL) {}
+	~CLogRingHolder()
+	{
+		if (m_pRing != NULL)
+		{
+			m_pRing->Close();
+			m_pRing = NULL;
+		}
+	}
+};
+
+static thread_local CLogRingHolder g_LogRingHolder;
+
+struct CLogSiteRegistry
+{
+	std::mutex						m_Mutex;
+	std::vector<const CLogSite*>	m_Sites;
+};
+
+static CLogSiteRegistry& GetSiteRegistry()
+{
+	static CLogSiteRegistry registry;
+	return registry;
+}
+
+CLogSite::CLogSite(const char* vFmt, const char* pFile, int nLine, uint32 nRate)
+	: m_pFormat(vFmt),
+	m_pFile(pFile),
+	m_nLine(nLine),
+	m_nRate(nRate),
+	m_nAllowAt(0),
+	m_nSuppressed(0)
+{
+	CLogSiteRegistry& registry = GetSiteRegistry();
+	std::lock_guard<std::mutex> lock(registry.m_Mutex);
+	m_nId = (uint32)registry.m_Sites.size();
+	registry.m_Sites.push_back(this);
+}
+
+bool CLogSite::TryAcquire(uint32 nRate)
+{
+	uint64 nNow = CTscClock::NowNs();
+	uint64 nInterval = 1000000000ULL / MAX(nRate, (uint32)1);
+	uint64 nAllowAt = m_nAllowAt.load(std::memory_order_relaxed);
+	uint64 nNext = 0;
+	do
+	{
+		uint64 nBase = MAX(nAllowAt, nNow);
+		if (nBase + nInterval - nNow > LOG_RATE_BURST_NS)
+		{
+			m_nSuppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		nNext = nBase + nInterval;
+	} while (!m_nAllowAt.compare_exchange_weak(nAllowAt, nNext, std::memory_order_relaxed));
+	return true;
+}
+
+const CLogSite* CLogSite::Find(uint32 nId)
+{
+	CLogSiteRegistry& registry = GetSiteRegistry();
+	std::lock_guard<std::mutex> lock(registry.m_Mutex);
+	return nId < registry.m_Sites.size() ? registry.m_Sites[nId] : NULL;
+}
+
+const CLogSite* CLogSite::TryFind(uint32 nId)
+{
+	CLogSiteRegistry& registry = GetSiteRegistry();
+	if (!registry.m_Mutex.try_lock())
+	{
+		return NULL;
+	}
+	const CLogSite* pSite = nId < registry.m_Sites.size() ? registry.m_Sites[nId] : NULL;
+	registry.m_Mutex.unlock();
+	return pSite;
+}
+
+CLogRing::CLogRing(uint32 nThread)
+	: m_pBuffer(new char[LOG_RING_SIZE]),
+	m_nThread(nThread),
+	m_bClosed(false),
+	m_nReserveTail(0),
+	m_nCachedHead(0),
+	m_nTail(0),
+	m_nHead(0)
+{
+	static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be power of 2");
+}
+
+CLogRing::~CLogRing()
+{
+	SAFE_DELETE_ARR(m_pBuffer);
+}
+
+char* CLogRing::Reserve(uint32 nSize)
+{
+	uint64 nTail = m_nTail.load(std::memory_order_relaxed);
+	uint32 nOffset = (uint32)(nTail & (LOG_RING_SIZE - 1));
+	uint32 nContiguous = LOG_RING_SIZE - nOffset;
+	//βŲʱһpadding,¼ӻͷд
+	uint32 nNeed = nContiguous < nSize ? nContiguous + nSize : nSize;
+	if (LOG_RING_SIZE - (nTail - m_nCachedHead) < nNeed)
+	{
+		m_nCachedHead = m_nHead.load(std::memory_order_acquire);
+		if (LOG_RING_SIZE - (nTail - m_nCachedHead) < nNeed)
+		{
+			return NULL;
+		}
+	}
+	if (nContiguous < nSize)
+	{
+		CLogRecord* pPad = (CLogRecord*)GetData(nTail);
+		pPad->m_nSize = nContiguous;
+		pPad->m_nKind = eLogRecordPad;
+		nTail += nContiguous;
+	}
+	m_nReserveTail = nTail + nSize;
+	return GetData(nTail);
+}
+
+void CLogRing::Commit()
+{
+	m_nTail.store(m_nReserveTail, std::memory_order_release);
+}
+
+void CConsoleLogSink::Write(int nKind, int nType, const char* pData, size_t nLen)
+{
+#if defined(__LINUX__)
+	if (m_bCrash)
+	{
+		//stdioźŴﲻȫ
+		ssize_t nRet = ::write(STDOUT_FILENO, pData, nLen);
+		(void)nRet;
+		return;
+	}
+#endif
+	fwrite(pData, 1, nLen, stdout);
+}
+
+void CConsoleLogSink::Flush()
+{
+	fflush(stdout);
+}
+
+void CConsoleLogSink::FlushOnCrash()
+{
+	//Windowsδ쳣,źŴ,ˢstdio
+#if !defined(__LINUX__)
+	fflush(stdout);
+#endif
+}
+
+void CLogLine::AppendInt64(int64 nValue)
+{
+	if (nValue < 0)
+	{
+		Append("-", 1);
+		//ֱȡINT64_MINʱ,޷ȡ
+		AppendUInt64(~(uint64)nValue + 1);
+		return;
+	}
+	AppendUInt64((uint64)nValue);
+}
+
+void CLogLine::AppendUInt64(uint64 nValue)
+{
+	char szNum[24];
+	char* pEnd = szNum + sizeof(szNum);
+	char* pBegin = pEnd;
+	do
+	{
+		*--pBegin = (char)('0' + nValue % 10);
+		nValue /= 10;
+	} while (nValue != 0);
+	Append(pBegin, pEnd - pBegin);
+}
+
+void CLogLine::AppendDouble(double fValue)
+{
+	char szNum[32];
+	int nLen = snprintf(szNum, sizeof(szNum), "%g", fValue);
+	if (nLen > 0)
+	{
+		Append(szNum, MIN((size_t)nLen, sizeof(szNum) - 1));
+	}
+}
+
+void CLogLine::AppendDoubleOnCrash(double fValue)
+{
+	if (fValue != fValue)
+	{
+		Append("nan", 3);
+		return;
+	}
+	if (fValue < 0)
+	{
+		Append("-", 1);
+		fValue = -fValue;
+	}
+	if (fValue > 1.7976931348623157e308)
+	{
+		Append("inf", 3);
+		return;
+	}
+	//ܱʾķΧʱd.dddddde+x
+	int nExp = 0;
+	if (fValue >= 1e18)
+	{
+		while (fValue >= 10.0)
+		{
+			fValue /= 10.0;
+			nExp++;
+		}
+	}
+	uint64 nScaled = (uint64)(fValue * 1000000.0 + 0.5);
+	AppendUInt64(nScaled / 1000000);
+	char szFrac[7];
+	uint64 nFrac = nScaled % 1000000;
+	for (int i = 5; i >= 0; i--)
+	{
+		szFrac[i] = (char)('0' + nFrac % 10);
+		nFrac /= 10;
+	}
+	szFrac[6] = '.';
+	Append(szFrac + 6, 1);
+	Append(szFrac, 6);
+	if (nExp > 0)
+	{
+		Append("e+", 2);
+		AppendUInt64((uint64)nExp);
+	}
+}
+
+void CLogLine::AppendPointer(uint64 nValue)
+{
+	static const char szHex[] = "0123456789abcdef";
+	char szNum[24];
+	char* pEnd = szNum + sizeof(szNum);
+	char* pBegin = pEnd;
+	do
+	{
+		*--pBegin = szHex[nValue & 0xf];
+		nValue >>= 4;
+	} while (nValue != 0);
+	*--pBegin = 'x';
+	*--pBegin = '0';
+	Append(pBegin, pEnd - pBegin);
+}
+
+CAsyncLog::CAsyncLog()
+	: m_bRunning(false),
+	m_nPolicy(eLogOverflowBlock),
+	m_nDropCount(0),
+	m_nReportedDrop(0),
+	m_bCrash(false),
+	m_nThreadSeq(0)
+{
+	m_bDraining.clear();
+}
+
+CAsyncLog::~CAsyncLog()
+{
+	Flush();
+	m_Segment.Close();
+	std::lock_guard<std::mutex> lock(m_ringMutex);
+	for (size_t i = 0; i < m_Rings.size(); i++)
+	{
+		SAFE_DELETE(m_Rings[i]);
+	}
+	m_Rings.clear();
+}
+
+void CAsyncLog::AddSink(ILogSink* pSink)
+{
+	if (pSink == NULL)
+	{
+		return;
+	}
+	LockDrain();
+	m_Sinks.push_back(pSink);
+	UnlockDrain();
+}
+
+void CAsyncLog::RemoveSink(ILogSink* pSink)
+{
+	LockDrain();
+	for (size_t i = 0; i < m_Sinks.size(); i++)
+	{
+		if (m_Sinks[i] == pSink)
+		{
+			m_Sinks.erase(m_Sinks.begin() + i);
+			break;
+		}
+	}
+	UnlockDrain();
+}
+
+CLogRing* CAsyncLog::GetThreadRing()
+{
+	CLogRing* pRing = g_LogRingHolder.m_pRing;
+	if (pRing != NULL)
+	{
+		return pRing;
+	}
+	pRing = new CLogRing(m_nThreadSeq.fetch_add(1, std::memory_order_relaxed));
+	{
+		std::lock_guard<std::mutex> lock(m_ringMutex);
+		m_Rings.push_back(pRing);
+	}
+	g_LogRingHolder.m_pRing = pRing;
+	return pRing;
+}
+
+char* CAsyncLog::BeginRecord(CLogRing* pRing, int nKind, int nType, const CLogSite& site, uint16 nArgCount, uint32 nSize)
+{
+	nSize = (uint32)LOG_RECORD_ALIGN(nSize);
+	char* pBuffer = NULL;
+	//ķ֮һļ¼ֱӶ,֤padding֮һŵ
+	if (nSize <= LOG_RING_SIZE / 4)
+	{
+		pBuffer = pRing->Reserve(nSize);
+		while (pBuffer == NULL && m_nPolicy.load(std::memory_order_relaxed) == eLogOverflowBlock)
+		{
+			if (IsRunning())
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				//̨߳Ѿֹͣ,ɵǰ߳Լ
+				Drain();
+			}
+			pBuffer = pRing->Reserve(nSize);
+		}
+	}
+	if (pBuffer == NULL)
+	{
+		m_nDropCount.fetch_add(1, std::memory_order_relaxed);
+		return NULL;
+	}
+	CLogRecord* pRecord = (CLogRecord*)pBuffer;
+	pRecord->m_nSize = nSize;
+	pRecord->m_nKind = (uint8)nKind;
+	pRecord->m_nType = (uint8)nType;
+	pRecord->m_nArgCount = nArgCount;
+	pRecord->m_nThread = pRing->GetThread();
+	pRecord->m_nSiteId = site.GetId();
+	pRecord->m_nTime = (uint64)CTimeHelper::GetSingletonPtr()->GetMicroTime();
+	pRecord->m_pFormat = site.GetFormat();
+	return pBuffer + sizeof(CLogRecord);
+}
+
+const char* CAsyncLog::GetLogName(int nKind, int nType)
+{
+	if (nKind == eLogRecordDisk && nType >= 0 && nType < DIS_LOG_MAX)
+	{
+		return g_DisLogFile[nType].second.c_str();
+	}
+	else if (nKind == eLogRecordCache && nType >= 0 && nType < CACHE_LOG_MAX)
+	{
+		return g_CacheLogFile[nType].second.c_str();
+	}
+	return "";
+}
+
+void CAsyncLog::FormatRecord(const CLogRecord* pRecord, const char* vFmt, CLogLine& line, bool bCrash)
+{
+	const char* pArg = (const char*)pRecord + sizeof(CLogRecord);
+	//빤߶Ƕļ,ͳȶ,ÿԽ¼ĩβ
+	const char* pEnd = (const char*)pRecord + pRecord->m_nSize;
+	int nArgLeft = pRecord->m_nArgCount;
+	while (*(vFmt = detail_log::log_copy_text(line, vFmt)) != '\0')
+	{
+		vFmt += 2;
+		const char* pData = pArg + sizeof(CLogArgHeader);
+		const CLogArgHeader* pHeader = nArgLeft > 0 ? detail_log::log_next_arg(pArg, pEnd) : NULL;
+		if (pHeader == NULL)
+		{
+			//߼¼,ռλԭ
+			nArgLeft = 0;
+			line.Append("{}", 2);
+			continue;
+		}
+		uint64 nValue = 0;
+		if (pHeader->m_nType != eLogArgString)
+		{
+			memcpy(&nValue, pData, sizeof(uint64));
+		}
+		switch (pHeader->m_nType)
+		{
+		case eLogArgString:
+			line.Append(pData, pHeader->m_nLen);
+			break;
+		case eLogArgUInt64:
+			line.AppendUInt64(nValue);
+			break;
+		case eLogArgDouble:
+		{
+			double fValue = 0;
+			memcpy(&fValue, &nValue, sizeof(double));
+			if (bCrash)
+			{
+				line.AppendDoubleOnCrash(fValue);
+			}
+			else
+			{
+				line.AppendDouble(fValue);
+			}
+			break;
+		}
+		case eLogArgPointer:
+			line.AppendPointer(nValue);
+			break;
+		default:
+			line.AppendInt64((int64)nValue);
+			break;
+		}
+		nArgLeft--;
+	}
+}
+
+void CAsyncLog::WriteLine(int nKind, int nType, const CLogLine& line)
+{
+	if (m_Sinks.empty())
+	{
+		m_ConsoleSink.Write(nKind, nType, line.GetData(), line.GetLen());
+		return;
+	}
+	for (size_t i = 0; i < m_Sinks.size(); i++)
+	{
+		m_Sinks[i]->Write(nKind, nType, line.GetData(), line.GetLen());
+	}
+}
+
+void CAsyncLog::WriteRecord(const CLogRecord* pRecord)
+{
+	//ģʽʽ,ԭд־
+	if (m_Segment.IsOpen())
+	{
+		if (m_bCrash)
+		{
+			m_Segment.WriteOnCrash(pRecord);
+		}
+		else
+		{
+			m_Segment.Write(pRecord);
+		}
+		return;
+	}
+	m_Line.Clear();
+	m_Line.Append("[", 1);
+	m_Line.Append(GetLogName(pRecord->m_nKind, pRecord->m_nType));
+	m_Line.Append("] ", 2);
+	FormatRecord(pRecord, pRecord->m_pFormat, m_Line, m_bCrash);
+	m_Line.Append(" \n", 2);
+	//Ŀתļ(localtime/open/mmap),ֻ֮д̨
+	if (m_bCrash)
+	{
+		m_ConsoleSink.Write(pRecord->m_nKind, pRecord->m_nType, m_Line.GetData(), m_Line.GetLen());
+		return;
+	}
+	WriteLine(pRecord->m_nKind, pRecord->m_nType, m_Line);
+}
+
+int CAsyncLog::DrainRing(CLogRing* pRing)
+{
+	int nCount = 0;
+	uint64 nHead = pRing->GetHead();
+	uint64 nTail = pRing->GetTail();
+	while (nHead < nTail)
+	{
+		const CLogRecord* pRecord = (const CLogRecord*)pRing->GetData(nHead);
+		if (pRecord->m_nKind != eLogRecordPad)
+		{
+			WriteRecord(pRecord);
+			nCount++;
+		}
+		nHead += pRecord->m_nSize;
+		//黹ռ,ȴ߿Ծ
+		pRing->SetHead(nHead);
+	}
+	return nCount;
+}
+
+int CAsyncLog::DrainLocked()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_ringMutex);
+		m_DrainRings.assign(m_Rings.begin(), m_Rings.end());
+	}
+	int nCount = 0;
+	bool bHasClosed = false;
+	for (size_t i = 0; i < m_DrainRings.size(); i++)
+	{
+		nCount += DrainRing(m_DrainRings[i]);
+		bHasClosed = bHasClosed || m_DrainRings[i]->IsClosed();
+	}
+	if (m_nPolicy.load(std::memory_order_relaxed) == eLogOverflowCount)
+	{
+		uint64 nDrop = GetDropCount();
+		if (nDrop > m_nReportedDrop)
+		{
+			m_Line.Clear();
+			detail_log::log_format(m_Line, "[{}] async log dropped {} records \n",
+				g_CacheLogFile[ERROR_CACHE].second, nDrop - m_nReportedDrop);
+			WriteLine(eLogRecordCache, ERROR_CACHE, m_Line);
+			m_nReportedDrop = nDrop;
+		}
+	}
+	if (bHasClosed)
+	{
+		//߳Ѿ˳Ļͷŵ,жϹرжΪ
+		std::lock_guard<std::mutex> lock(m_ringMutex);
+		for (size_t i = 0; i < m_Rings.size();)
+		{
+			CLogRing* pRing = m_Rings[i];
+			if (pRing->IsClosed() && pRing->IsEmpty())
+			{
+				m_Rings[i] = m_Rings.back();
+				m_Rings.pop_back();
+				delete pRing;
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+	return nCount;
+}
+
+int CAsyncLog::Drain()
+{
+	if (m_bDraining.test_and_set(std::memory_order_acquire))
+	{
+		return 0;
+	}
+	int nCount = DrainLocked();
+	m_bDraining.clear(std::memory_order_release);
+	return nCount;
+}
+
+void CAsyncLog::LockDrain()
+{
+	while (m_bDraining.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+}
+
+bool CAsyncLog::EnableBinary(const char* pPrefix, size_t nSegmentSize)
+{
+	LockDrain();
+	//л֮ǰļ¼԰ı
+	while (DrainLocked() > 0)
+	{
+	}
+	bool bRet = m_Segment.Open(pPrefix, nSegmentSize);
+	UnlockDrain();
+	return bRet;
+}
+
+void CAsyncLog::Flush()
+{
+	LockDrain();
+	while (DrainLocked() > 0)
+	{
+	}
+	m_Segment.Sync();
+	for (size_t i = 0; i < m_Sinks.size(); i++)
+	{
+		m_Sinks[i]->Flush();
+	}
+	m_ConsoleSink.Flush();
+	UnlockDrain();
+}
+
+int CAsyncLog::DrainOnCrash()
+{
+	//߳̿m_ringMutex(GetThreadRing),òͷ,źŴ
+	if (!m_ringMutex.try_lock())
+	{
+		return 0;
+	}
+	size_t nRingCount = MIN(m_Rings.size(), (size_t)LOG_CRASH_MAX_RINGS);
+	for (size_t i = 0; i < nRingCount; i++)
+	{
+		m_CrashRings[i] = m_Rings[i];
+	}
+	m_ringMutex.unlock();
+	int nCount = 0;
+	for (size_t i = 0; i < nRingCount; i++)
+	{
+		nCount += DrainRing(m_CrashRings[i]);
+	}
+	return nCount;
+}
+
+void CAsyncLog::FlushOnCrash()
+{
+	//ĿԼ,޴γòͷ,ĿбҲֻڳʱ
+	bool bLocked = false;
+	for (int i = 0; i < 1000 && !bLocked; i++)
+	{
+		bLocked = !m_bDraining.test_and_set(std::memory_order_acquire);
+		if (!bLocked)
+		{
+			std::this_thread::yield();
+		}
+	}
+	if (!bLocked)
+	{
+		return;
+	}
+	//ֻ֮иʽõıwrite(2)д̨,ԭǰ־,ĿѾдӳںд
+	m_bCrash = true;
+	m_ConsoleSink.SetCrash();
+	DrainOnCrash();
+	m_ConsoleSink.FlushOnCrash();
+	UnlockDrain();
+}
+
+#if defined(__LINUX__)
+static void LogCrashHandler(int nSignal)
+{
+	static std::atomic_flag bHandling = ATOMIC_FLAG_INIT;
+	if (!bHandling.test_and_set())
+	{
+		CAsyncLog::GetSingletonPtr()->FlushOnCrash();
+	}
+	//ָĬϴ׳,core dump
+	std::signal(nSignal, SIG_DFL);
+	std::raise(nSignal);
+}
+#else
+static LONG WINAPI LogCrashFilter(EXCEPTION_POINTERS* pException)
+{
+	CAsyncLog::GetSingletonPtr()->FlushOnCrash();
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
+void CAsyncLog::InstallCrashHandler()
+{
+#if defined(__LINUX__)
+	std::signal(SIGSEGV, LogCrashHandler);
+	std::signal(SIGABRT, LogCrashHandler);
+	std::signal(SIGFPE, LogCrashHandler);
+	std::signal(SIGILL, LogCrashHandler);
+	std::signal(SIGBUS, LogCrashHandler);
+#else
+	SetUnhandledExceptionFilter(LogCrashFilter);
+#endif
+}
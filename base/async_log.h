@@ -0,0 +1,452 @@
+/*****************************************************************
+* FileName:async_log.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __ASYNC_LOG_H__
+#define __ASYNC_LOG_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <string.h>
+#include <stdint.h>
+#include <type_traits>
+#include "base.h"
+#include "singleton.h"
+#include "log_segment.h"
+
+//ʱͻ:һڵһ
+#define LOG_RATE_BURST_NS		(1000000000ULL)
+//ÿ߳־λĴС,2
+#define LOG_RING_SIZE			(256 * 1024)
+//ַ¼ֽ,ֽض
+#define LOG_MAX_STRING_ARG		(4096)
+//ʽһ־󳤶,ֽض
+#define LOG_LINE_SIZE			(8192)
+//ʱȡ̻߳,źŴﲻܷڴ,Ԥȷ
+#define LOG_CRASH_MAX_RINGS		(1024)
+//¼8ֽڶ
+#define LOG_RECORD_ALIGN(size)	(((size) + 7) & ~((size_t)7))
+
+//־¼
+enum enLogRecordKind
+{
+	eLogRecordPad = 0,		//λβ,
+	eLogRecordDisk = 1,		//DISK_LOG
+	eLogRecordCache = 2,	//CACHE_LOG
+	eLogRecordFormat = 3,	//־ĵõ㶨
+};
+
+//ı
+enum enLogArgType
+{
+	eLogArgInt64 = 0,		//з/ö/bool
+	eLogArgUInt64 = 1,		//޷
+	eLogArgDouble = 2,		//
+	eLogArgString = 3,		//ַ,ݸڲͷ
+	eLogArgPointer = 4,		//ַָ,ʮ
+};
+
+//ʱĴ
+enum enLogOverflowPolicy
+{
+	eLogOverflowBlock = 0,	//ȴ̨߳ڳռ
+	eLogOverflowDrop = 1,	//,ֻۼƵͳ
+	eLogOverflowCount = 2,	//,̶̨߳
+};
+
+/**
+ * ־¼ͷ,m_nArgCount,ÿΪCLogArgHeader+,8ֽڶ
+ * ʽָֻ,CACHE_LOG/DISK_LOGĸʽַ
+ */
+struct CLogRecord
+{
+	uint32			m_nSize;		//¼ֽ(ͷ)
+	uint8			m_nKind;		//enLogRecordKind
+	uint8			m_nType;		//enDiskLog/enCacheLog
+	uint16			m_nArgCount;
+	uint32			m_nThread;		//д־߳
+	uint32			m_nSiteId;		//õ,־ҵʽ
+	uint64			m_nTime;		//΢ʱ(CTimeHelperʱ)
+	const char*		m_pFormat;
+};
+
+struct CLogArgHeader
+{
+	uint8			m_nType;		//enLogArgType
+	uint8			m_nReserve[3];
+	uint32			m_nLen;			//ݵֽ
+};
+
+/**
+ * ־õ,ÿCACHE_LOG/DISK_LOGչһ̬,һִʱעᲢ
+ * GCRAʽͰ:m_nAllowAtһ۷ʱ,ǰLOG_RATE_BURST_NS,߳CAS
+ */
+class CLogSite
+{
+public:
+	CLogSite(const char* vFmt, const char* pFile, int nLine, uint32 nRate = 0);
+	uint32		GetId() const		{ return m_nId; }
+	const char*	GetFormat() const	{ return m_pFormat; }
+	const char*	GetFile() const		{ return m_pFile; }
+	int			GetLine() const		{ return m_nLine; }
+	//ÿе,0ʾʹCLogĬ
+	uint32		GetRate() const		{ return m_nRate; }
+	//nRate/ȡһ,ȡʱ뱻ѹ
+	bool		TryAcquire(uint32 nRate);
+	//ȡ㱻ѹ
+	uint64		TakeSuppressed()
+	{
+		return m_nSuppressed.load(std::memory_order_relaxed) == 0 ? 0 : m_nSuppressed.exchange(0, std::memory_order_relaxed);
+	}
+	//Ųҵõ,Ŵ0ʼ
+	static const CLogSite*	Find(uint32 nId);
+	//ʱ:עֻһ,ò(߳̿ע)NULL
+	static const CLogSite*	TryFind(uint32 nId);
+private:
+	const char*	m_pFormat;
+	const char*	m_pFile;
+	int			m_nLine;
+	uint32		m_nId;
+	uint32		m_nRate;
+	std::atomic<uint64>	m_nAllowAt;
+	std::atomic<uint64>	m_nSuppressed;
+};
+
+/**
+ * ߵߵֽڻλ,д־߳,־̨߳
+ * дλõ,ռһ;¼Խβ,ŲʱβһeLogRecordPad
+ */
+class CLogRing
+{
+public:
+	CLogRing(uint32 nThread);
+	~CLogRing();
+	CACHE_LINE_NEW_DELETE
+	//nSizeֽ(Ѷ),ռ䲻NULL
+	char*	Reserve(uint32 nSize);
+	//ύһReserveļ¼
+	void	Commit();
+	//:ǰɶλ
+	uint64	GetHead()	{ return m_nHead.load(std::memory_order_relaxed); }
+	uint64	GetTail()	{ return m_nTail.load(std::memory_order_acquire); }
+	char*	GetData(uint64 nPos)	{ return m_pBuffer + (nPos & (LOG_RING_SIZE - 1)); }
+	void	SetHead(uint64 nPos)	{ m_nHead.store(nPos, std::memory_order_release); }
+	bool	IsEmpty()	{ return GetHead() == GetTail(); }
+	uint32	GetThread()	{ return m_nThread; }
+	//߳˳֮,Ϳͷ
+	void	Close()		{ m_bClosed.store(true, std::memory_order_release); }
+	bool	IsClosed()	{ return m_bClosed.load(std::memory_order_acquire); }
+private:
+	char*							m_pBuffer;
+	uint32							m_nThread;
+	std::atomic_bool				m_bClosed;
+	//˽
+	uint64							m_nReserveTail;	//Reserve֮ύдλ
+	uint64							m_nCachedHead;	//Ķλ,ռ䲻ʱ¶ȡ
+	CACHE_LINE_ALIGN std::atomic<uint64>	m_nTail;
+	CACHE_LINE_ALIGN std::atomic<uint64>	m_nHead;
+};
+
+//־Ŀ,ֻ־̨߳(ͬʱ߳)ϵ,ʱ
+class ILogSink
+{
+public:
+	virtual ~ILogSink() {}
+	//nKindΪenLogRecordKind,nTypeΪӦ־,pDataһ()
+	virtual void Write(int nKind, int nType, const char* pData, size_t nLen) = 0;
+	virtual void Flush() = 0;
+};
+
+//׼
+class CConsoleLogSink : public ILogSink
+{
+public:
+	CConsoleLogSink() : m_bCrash(false) {}
+	virtual void Write(int nKind, int nType, const char* pData, size_t nLen);
+	virtual void Flush();
+	void	FlushOnCrash();
+	//֮پstdio,ֱwrite
+	void	SetCrash()			{ m_bCrash = true; }
+private:
+	bool	m_bCrash;
+};
+
+/**
+ * ־л,ʽʱڴ,ֽض
+ */
+class CLogLine
+{
+public:
+	CLogLine() : m_nLen(0) {}
+	void		Clear()				{ m_nLen = 0; }
+	const char*	GetData() const		{ return m_szData; }
+	size_t		GetLen() const		{ return m_nLen; }
+	void		Append(const char* pData, size_t nLen)
+	{
+		nLen = MIN(nLen, LOG_LINE_SIZE - m_nLen);
+		memcpy(m_szData + m_nLen, pData, nLen);
+		m_nLen += nLen;
+	}
+	void		Append(const char* pData)	{ Append(pData, strlen(pData)); }
+	void		AppendInt64(int64 nValue);
+	void		AppendUInt64(uint64 nValue);
+	void		AppendDouble(double fValue);
+	//snprintf,6λС(ܴѧ),źŴʹ
+	void		AppendDoubleOnCrash(double fValue);
+	//ָ밴ʮ
+	void		AppendPointer(uint64 nValue);
+private:
+	char		m_szData[LOG_LINE_SIZE];
+	size_t		m_nLen;
+};
+
+namespace detail_log {
+
+	/**
+	 * ͳƸʽ"{}"ĸ,ʽгֵ'{''}'ʱ-1
+	 * ֻõreturnĵݹ,֤c++11Ҳconstexpr
+	 */
+	constexpr int placeholder_count(const char* vFmt, int nCount = 0)
+	{
+		return *vFmt == '\0' ? nCount :
+			*vFmt == '{' ? (vFmt[1] == '}' ? placeholder_count(vFmt + 2, nCount + 1) : -1) :
+			*vFmt == '}' ? -1 : placeholder_count(vFmt + 1, nCount);
+	}
+
+	//ѡ:ַ,ָ//޷/зԱ64λԭֵ
+	template<typename T>
+	struct is_log_string : std::integral_constant<bool,
+		std::is_same<typename std::decay<T>::type, std::string>::value ||
+		std::is_same<typename std::decay<T>::type, const char*>::value ||
+		std::is_same<typename std::decay<T>::type, char*>::value> {};
+
+	template<typename T, typename Tp = typename std::decay<T>::type>
+	struct log_arg_type : std::integral_constant<int,
+		is_log_string<T>::value ? eLogArgString :
+		std::is_pointer<Tp>::value ? eLogArgPointer :
+		std::is_floating_point<Tp>::value ? eLogArgDouble :
+		std::is_unsigned<Tp>::value && !std::is_same<Tp, bool>::value ? eLogArgUInt64 : eLogArgInt64> {};
+
+	typedef std::integral_constant<int, eLogArgInt64>	int64_tag;
+	typedef std::integral_constant<int, eLogArgUInt64>	uint64_tag;
+	typedef std::integral_constant<int, eLogArgDouble>	double_tag;
+	typedef std::integral_constant<int, eLogArgString>	string_tag;
+	typedef std::integral_constant<int, eLogArgPointer>	pointer_tag;
+
+	inline uint32 log_string_len(const std::string& val)	{ return (uint32)MIN(val.size(), (size_t)LOG_MAX_STRING_ARG); }
+	inline uint32 log_string_len(const char* val)			{ return val == NULL ? 0 : (uint32)strnlen(val, LOG_MAX_STRING_ARG); }
+	inline const char* log_string_data(const std::string& val)	{ return val.data(); }
+	inline const char* log_string_data(const char* val)		{ return val; }
+
+	template<typename T>
+	int64 log_arg_value(const T& val, int64_tag)		{ return static_cast<int64>(val); }
+	template<typename T>
+	uint64 log_arg_value(const T& val, uint64_tag)		{ return static_cast<uint64>(val); }
+	template<typename T>
+	double log_arg_value(const T& val, double_tag)		{ return static_cast<double>(val); }
+	template<typename T>
+	uint64 log_arg_value(const T& val, pointer_tag)		{ return (uint64)reinterpret_cast<uintptr_t>(val); }
+
+	template<typename T>
+	uint32 log_arg_size(const T& val, string_tag)		{ return (uint32)(sizeof(CLogArgHeader) + LOG_RECORD_ALIGN(log_string_len(val))); }
+	template<typename T, typename Tag>
+	uint32 log_arg_size(const T&, Tag)					{ return (uint32)(sizeof(CLogArgHeader) + sizeof(uint64)); }
+
+	template<typename T>
+	char* log_arg_encode(char* pBuffer, const T& val, string_tag)
+	{
+		CLogArgHeader* pHeader = (CLogArgHeader*)pBuffer;
+		pHeader->m_nType = eLogArgString;
+		pHeader->m_nLen = log_string_len(val);
+		memcpy(pBuffer + sizeof(CLogArgHeader), log_string_data(val), pHeader->m_nLen);
+		return pBuffer + sizeof(CLogArgHeader) + LOG_RECORD_ALIGN(pHeader->m_nLen);
+	}
+
+	template<typename T, typename Tag>
+	char* log_arg_encode(char* pBuffer, const T& val, Tag tag)
+	{
+		CLogArgHeader* pHeader = (CLogArgHeader*)pBuffer;
+		pHeader->m_nType = Tag::value;
+		pHeader->m_nLen = sizeof(uint64);
+		auto value = log_arg_value(val, tag);
+		memcpy(pBuffer + sizeof(CLogArgHeader), &value, sizeof(value));
+		return pBuffer + sizeof(CLogArgHeader) + sizeof(uint64);
+	}
+
+	/**
+	 * pArgĲpArgƵһ,pEndΪ¼ĩβ
+	 * ͷ()ݱڼ¼,ֵĳȱ8ֽ,򷵻NULL(ļ)
+	 */
+	inline const CLogArgHeader* log_next_arg(const char*& pArg, const char* pEnd)
+	{
+		if (pArg > pEnd || (size_t)(pEnd - pArg) < sizeof(CLogArgHeader))
+		{
+			return NULL;
+		}
+		const CLogArgHeader* pHeader = (const CLogArgHeader*)pArg;
+		size_t nLeft = (size_t)(pEnd - pArg) - sizeof(CLogArgHeader);
+		if ((pHeader->m_nType != eLogArgString && pHeader->m_nLen != sizeof(uint64))
+			|| pHeader->m_nLen > nLeft || LOG_RECORD_ALIGN((size_t)pHeader->m_nLen) > nLeft)
+		{
+			return NULL;
+		}
+		pArg += sizeof(CLogArgHeader) + LOG_RECORD_ALIGN((size_t)pHeader->m_nLen);
+		return pHeader;
+	}
+
+	template<typename T>
+	void log_arg_append(CLogLine& line, const T& val, string_tag)	{ line.Append(log_string_data(val), log_string_len(val)); }
+	template<typename T>
+	void log_arg_append(CLogLine& line, const T& val, int64_tag)	{ line.AppendInt64(log_arg_value(val, int64_tag())); }
+	template<typename T>
+	void log_arg_append(CLogLine& line, const T& val, uint64_tag)	{ line.AppendUInt64(log_arg_value(val, uint64_tag())); }
+	template<typename T>
+	void log_arg_append(CLogLine& line, const T& val, double_tag)	{ line.AppendDouble(log_arg_value(val, double_tag())); }
+	template<typename T>
+	void log_arg_append(CLogLine& line, const T& val, pointer_tag)	{ line.AppendPointer(log_arg_value(val, pointer_tag())); }
+
+	inline uint32 log_args_size() { return 0; }
+
+	template<typename T, typename... Rest>
+	uint32 log_args_size(const T& val, const Rest&... rest)
+	{
+		return log_arg_size(val, typename log_arg_type<T>::type()) + log_args_size(rest...);
+	}
+
+	inline char* log_args_encode(char* pBuffer) { return pBuffer; }
+
+	template<typename T, typename... Rest>
+	char* log_args_encode(char* pBuffer, const T& val, const Rest&... rest)
+	{
+		return log_args_encode(log_arg_encode(pBuffer, val, typename log_arg_type<T>::type()), rest...);
+	}
+
+	//"{}"֮ǰıл,ָ"{}"βλ
+	inline const char* log_copy_text(CLogLine& line, const char* vFmt)
+	{
+		const char* pBegin = vFmt;
+		while (*vFmt != '\0' && !(vFmt[0] == '{' && vFmt[1] == '}'))
+		{
+			vFmt++;
+		}
+		line.Append(pBegin, vFmt - pBegin);
+		return vFmt;
+	}
+
+	//ֱӰʽ,ͬʱʹ
+	inline void log_format(CLogLine& line, const char* vFmt)
+	{
+		while (*(vFmt = log_copy_text(line, vFmt)) != '\0')
+		{
+			line.Append("{}", 2);
+			vFmt += 2;
+		}
+	}
+
+	template<typename T, typename... Rest>
+	void log_format(CLogLine& line, const char* vFmt, const T& val, const Rest&... rest)
+	{
+		vFmt = log_copy_text(line, vFmt);
+		if (*vFmt != '\0')
+		{
+			log_arg_append(line, val, typename log_arg_type<T>::type());
+			vFmt += 2;
+		}
+		log_format(line, vFmt, rest...);
+	}
+}
+
+/**
+ * 첽־:д־̰߳ѶƼ¼дԼĻλ,
+ * ־̨߳(CLogThread)DrainͳһʽдĿ,߳ûиʽIO
+ * ̨߳ûʱCLogȻͬ
+ */
+class CAsyncLog : public CSingleton<CAsyncLog>
+{
+public:
+	CAsyncLog();
+	~CAsyncLog();
+	//̨߳/ֹͣʱ
+	void	SetRunning(bool bRunning)	{ m_bRunning.store(bRunning, std::memory_order_release); }
+	bool	IsRunning()					{ return m_bRunning.load(std::memory_order_acquire); }
+	void	SetOverflowPolicy(enLogOverflowPolicy ePolicy)	{ m_nPolicy.store(ePolicy, std::memory_order_relaxed); }
+	//Ŀ,ûʱ׼;߻,ʱԵ
+	void	AddSink(ILogSink* pSink);
+	//ƳĿ,߲֮ʹ
+	void	RemoveSink(ILogSink* pSink);
+	//дһ¼,falseʾ
+	template<typename... Args>
+	bool	Push(int nKind, int nType, const CLogSite& site, const Args&... args);
+	//̻߳ļ¼,ش,ͬһʱֻһ
+	int		Drain();
+	//м¼ˢĿ
+	void	Flush();
+	//򿪶ģʽ:־̲߳ٸʽ,¼ԭдpPrefixͷڴӳ־
+	bool	EnableBinary(const char* pPrefix, size_t nSegmentSize = LOG_SEGMENT_SIZE);
+	bool	IsBinary()					{ return m_Segment.IsOpen(); }
+	uint64	GetBinaryBytes()			{ return m_Segment.GetWriteBytes(); }
+	//һ¼vFmtʽһı(־ǰ׺ͻ),߽Ҳ;bCrashʱֻ첽źŰȫĲ
+	static void	FormatRecord(const CLogRecord* pRecord, const char* vFmt, CLogLine& line, bool bCrash = false);
+	//־ͶӦ
+	static const char* GetLogName(int nKind, int nType);
+	//Ѿļ¼
+	uint64	GetDropCount()				{ return m_nDropCount.load(std::memory_order_relaxed); }
+	//װʱˢ־źŴ(SIGSEGV/SIGABRT/SIGFPE/SIGILL/SIGBUS,WindowsΪδ쳣)
+	static void InstallCrashHandler();
+	//ʱ,ѻ־дȥ
+	void	FlushOnCrash();
+private:
+	//ǰ̵߳Ļλ,һд־ʱ
+	CLogRing*	GetThreadRing();
+	//ʼһ¼,ü¼ͷ,زλ
+	char*		BeginRecord(CLogRing* pRing, int nKind, int nType, const CLogSite& site, uint16 nArgCount, uint32 nSize);
+	//һ¼,ģʽд־,ʽдĿ;֮ıֻд̨,־β
+	void		WriteRecord(const CLogRecord* pRecord);
+	//һдĿ
+	void		WriteLine(int nKind, int nType, const CLogLine& line);
+	int			DrainRing(CLogRing* pRing);
+	int			DrainLocked();
+	//ʱ:ֻһm_ringMutex,бԤȷĿ,ڴҲͷŻ
+	int			DrainOnCrash();
+	//,òóCPUȴ
+	void		LockDrain();
+	void		UnlockDrain()	{ m_bDraining.clear(std::memory_order_release); }
+private:
+	std::atomic_bool				m_bRunning;
+	std::atomic_int					m_nPolicy;
+	std::atomic<uint64>				m_nDropCount;
+	uint64							m_nReportedDrop;	//ѾĶ
+	std::atomic_flag				m_bDraining;		//
+	bool							m_bCrash;			//ʱд
+	std::mutex						m_ringMutex;
+	std::vector<CLogRing*>			m_Rings;
+	std::vector<CLogRing*>			m_DrainRings;		//ʱĿ,ֻʹ
+	CLogRing*						m_CrashRings[LOG_CRASH_MAX_RINGS];	//ʱĿ
+	std::atomic_uint				m_nThreadSeq;
+	std::vector<ILogSink*>			m_Sinks;			//ֻڳʱд
+	CConsoleLogSink					m_ConsoleSink;
+	CLogLine						m_Line;				//ֻʹ
+	CLogSegmentWriter				m_Segment;			//ģʽ,ֻʹ
+	friend struct CLogRingHolder;
+};
+
+template<typename... Args>
+bool CAsyncLog::Push(int nKind, int nType, const CLogSite& site, const Args&... args)
+{
+	CLogRing* pRing = GetThreadRing();
+	uint32 nSize = (uint32)(sizeof(CLogRecord) + detail_log::log_args_size(args...));
+	char* pArgs = BeginRecord(pRing, nKind, nType, site, (uint16)sizeof...(Args), nSize);
+	if (pArgs == NULL)
+	{
+		return false;
+	}
+	detail_log::log_args_encode(pArgs, args...);
+	pRing->Commit();
+	return true;
+}
+
+#endif //__ASYNC_LOG_H__
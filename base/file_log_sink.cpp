@@ -0,0 +1,159 @@
+#include "file_log_sink.h"
+#include "time_helper.h"
+#if defined(__LINUX__)
+#include <sys/stat.h>
+#endif
+
+CFileLogSink::CFileLogSink()
+	: m_nSegmentSize(FILE_LOG_SEGMENT_SIZE),
+	m_nRotateSeconds(FILE_LOG_ROTATE_SECONDS),
+	m_nSyncInterval(FILE_LOG_SYNC_INTERVAL),
+	m_nNextSync(0),
+	m_nFileCount(0),
+	m_nDropLines(0)
+{
+}
+
+CFileLogSink::~CFileLogSink()
+{
+	Close();
+}
+
+bool CFileLogSink::Init(const char* pDir, size_t nSegmentSize, int nRotateSeconds, int nSyncInterval)
+{
+	Close();
+#if defined(__LINUX__)
+	if (mkdir(pDir, 0755) != 0 && errno != EEXIST)
+	{
+		return false;
+	}
+#else
+	if (!CreateDirectoryA(pDir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		return false;
+	}
+#endif
+	m_Dir = pDir;
+	m_nSegmentSize = MAX(nSegmentSize, (size_t)LOG_LINE_SIZE);
+	m_nRotateSeconds = MAX(nRotateSeconds, 0);
+	m_nSyncInterval = MAX(nSyncInterval, 0);
+	m_nNextSync = 0;
+	return true;
+}
+
+CFileLogSink::CLogSegment* CFileLogSink::GetSegment(int nKind, int nType)
+{
+	if (nKind == eLogRecordDisk && nType >= 0 && nType < DIS_LOG_MAX)
+	{
+		return &m_DiskSegments[nType];
+	}
+	else if (nKind == eLogRecordCache && nType >= 0 && nType < CACHE_LOG_MAX)
+	{
+		return &m_CacheSegments[nType];
+	}
+	return NULL;
+}
+
+time_t CFileLogSink::GetRotateTime(time_t nNow)
+{
+	if (m_nRotateSeconds <= 0)
+	{
+		return 0;
+	}
+	//챾ʱ,һԼʱÿת̶
+	std::tm tm = CTimeHelper::LocalTime(nNow);
+	time_t nDaySecond = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+	return nNow - nDaySecond % m_nRotateSeconds + m_nRotateSeconds;
+}
+
+void CFileLogSink::CloseSegment(CLogSegment& segment)
+{
+	if (segment.m_File.IsOpen())
+	{
+		//munmap֮ҳҳںд,ﲻȴ
+		segment.m_File.Close(segment.m_nUsed);
+	}
+	segment.m_nUsed = 0;
+	segment.m_nSynced = 0;
+}
+
+bool CFileLogSink::Rotate(CLogSegment& segment, int nKind, int nType, time_t nNow)
+{
+	CloseSegment(segment);
+	std::tm tm = CTimeHelper::LocalTime(nNow);
+	char szPath[512];
+	snprintf(szPath, sizeof(szPath), "%s/%s.%04d%02d%02d-%02d%02d%02d.%u.log",
+		m_Dir.c_str(), CAsyncLog::GetLogName(nKind, nType),
+		tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, segment.m_nIndex);
+	if (!segment.m_File.Open(szPath, m_nSegmentSize))
+	{
+		return false;
+	}
+	segment.m_nIndex++;
+	segment.m_nRotateTime = GetRotateTime(nNow);
+	m_nFileCount++;
+	return true;
+}
+
+void CFileLogSink::Write(int nKind, int nType, const char* pData, size_t nLen)
+{
+	CLogSegment* pSegment = GetSegment(nKind, nType);
+	if (pSegment == NULL || m_Dir.empty())
+	{
+		return;
+	}
+	if (nLen > m_nSegmentSize)
+	{
+		m_nDropLines++;
+		return;
+	}
+	//ʱ,ϵͳ
+	time_t nNow = CTimeHelper::GetSingletonPtr()->GetANSITime();
+	if (!pSegment->m_File.IsOpen() || pSegment->m_nUsed + nLen > pSegment->m_File.GetSize()
+		|| (pSegment->m_nRotateTime > 0 && nNow >= pSegment->m_nRotateTime))
+	{
+		if (!Rotate(*pSegment, nKind, nType, nNow))
+		{
+			m_nDropLines++;
+			return;
+		}
+	}
+	memcpy(pSegment->m_File.GetData() + pSegment->m_nUsed, pData, nLen);
+	pSegment->m_nUsed += nLen;
+
+	uint64 nNowMs = CTimeHelper::GetSingletonPtr()->GetMSTime();
+	if (nNowMs >= m_nNextSync)
+	{
+		Flush();
+		m_nNextSync = nNowMs + m_nSyncInterval;
+	}
+}
+
+void CFileLogSink::Flush()
+{
+	//͵ļһύ,һÿļһmsync
+	for (int index = 0; index < DIS_LOG_MAX; index++)
+	{
+		CLogSegment& segment = m_DiskSegments[index];
+		segment.m_File.Sync(segment.m_nSynced, segment.m_nUsed - segment.m_nSynced);
+		segment.m_nSynced = segment.m_nUsed;
+	}
+	for (int index = 0; index < CACHE_LOG_MAX; index++)
+	{
+		CLogSegment& segment = m_CacheSegments[index];
+		segment.m_File.Sync(segment.m_nSynced, segment.m_nUsed - segment.m_nSynced);
+		segment.m_nSynced = segment.m_nUsed;
+	}
+}
+
+void CFileLogSink::Close()
+{
+	for (int index = 0; index < DIS_LOG_MAX; index++)
+	{
+		CloseSegment(m_DiskSegments[index]);
+	}
+	for (int index = 0; index < CACHE_LOG_MAX; index++)
+	{
+		CloseSegment(m_CacheSegments[index]);
+	}
+}
@@ -0,0 +1,74 @@
+/*****************************************************************
+* FileName:file_log_sink.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __FILE_LOG_SINK_H__
+#define __FILE_LOG_SINK_H__
+
+#include <string>
+#include "log.h"
+#include "mmap_file.h"
+
+//־ļԤĴС
+#define FILE_LOG_SEGMENT_SIZE		(128 * 1024 * 1024)
+//ʱתļ(),ʱ,0ʾֻСת
+#define FILE_LOG_ROTATE_SECONDS		(3600)
+//ύдصļ()
+#define FILE_LOG_SYNC_INTERVAL		(1000)
+
+/**
+ * ־(enDiskLog/enCacheLog)ļ,ļΪ Ŀ¼/־.ʱ..log
+ * ÿļԤչ̶Сӳڴ,дһоһڴ濽;дתʱ任һļ,
+ * رʱضϵʵʳȡļÿһʱһmsync(MS_ASYNC)ںд,־߳ϴӲfsync
+ * ļڸ͵һд־ʱŴ,ֻ־̨߳ʹ
+ */
+class CFileLogSink : public ILogSink
+{
+public:
+	CFileLogSink();
+	virtual ~CFileLogSink();
+	//־߳ǰ,pDirʱ
+	bool	Init(const char* pDir,
+		size_t nSegmentSize = FILE_LOG_SEGMENT_SIZE,
+		int nRotateSeconds = FILE_LOG_ROTATE_SECONDS,
+		int nSyncInterval = FILE_LOG_SYNC_INTERVAL);
+	virtual void Write(int nKind, int nType, const char* pData, size_t nLen);
+	//ļδύĲֽںд,ȴ
+	virtual void Flush();
+	//رļ,־ֹ߳ͣ
+	void	Close();
+	//򿪹ļ
+	uint32	GetFileCount()		{ return m_nFileCount; }
+	//ļʧܻߵбļ󱻶
+	uint64	GetDropLines()		{ return m_nDropLines; }
+private:
+	struct CLogSegment
+	{
+		CLogSegment() : m_nUsed(0), m_nSynced(0), m_nRotateTime(0), m_nIndex(0) {}
+		CMmapFile		m_File;
+		size_t			m_nUsed;
+		size_t			m_nSynced;
+		time_t			m_nRotateTime;		//ʱ任ļ,0ʾʱת
+		uint32			m_nIndex;
+	};
+	CLogSegment*	GetSegment(int nKind, int nType);
+	//رյǰļ,һ
+	bool	Rotate(CLogSegment& segment, int nKind, int nType, time_t nNow);
+	void	CloseSegment(CLogSegment& segment);
+	//һתʱ
+	time_t	GetRotateTime(time_t nNow);
+private:
+	std::string		m_Dir;
+	size_t			m_nSegmentSize;
+	int				m_nRotateSeconds;
+	int				m_nSyncInterval;
+	uint64			m_nNextSync;
+	uint32			m_nFileCount;
+	uint64			m_nDropLines;
+	CLogSegment		m_DiskSegments[DIS_LOG_MAX];
+	CLogSegment		m_CacheSegments[CACHE_LOG_MAX];
+};
+
+#endif //__FILE_LOG_SINK_H__
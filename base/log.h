@@ -8,6 +8,7 @@
 #define __LOG_H__
 
 #include "singleton.h"
+#include "async_log.h"
 #define  CONSOLE_LOG_NAME "console"
 #define  MAX_SPDLOG_QUEUE_SIZE (102400)
 #define  MAX_SPDLOG_THREAD_POOL (4)
@@ -42,156 +43,188 @@ static std::pair<int, std::string> g_CacheLogFile[] =
 	{enCacheLog::THREAD_ERROR,"thread_error"},
 };
 
-namespace detail_log {
+//־,ÿenDiskLog/enCacheLogһ
+enum enLogLevel
+{
+	eLogLevelDebug = 0,
+	eLogLevelError = 1,
+	eLogLevelFatal = 2,
+	eLogLevelMax,
+};
 
-	// жǷΪַͣڷɸʽת
-	template<typename T> struct is_string_type : std::false_type {};
-	template<> struct is_string_type<std::string> : std::true_type {};
-	template<> struct is_string_type<const std::string&> : std::true_type {};
-	template<> struct is_string_type<const char*> : std::true_type {};
-	template<> struct is_string_type<char*> : std::true_type {};
-	template<size_t N> struct is_string_type<char[N]> : std::true_type {};
-	template<size_t N> struct is_string_type<const char[N]> : std::true_type {};
-
-	// תַ -> const char* -> long %s / %ld Ӧ
-	inline const char* convert_arg(const std::string& val) { return val.c_str(); }
-	inline const char* convert_arg(const char* val)        { return val; }
-	inline const char* convert_arg(char* val)              { return val; }
-	template<size_t N>
-	inline const char* convert_arg(const char(&val)[N])     { return val; }
-	template<size_t N>
-	inline const char* convert_arg(char(&val)[N])           { return val; }
-
-	template<typename T>
-	typename std::enable_if<
-		!is_string_type<typename std::decay<T>::type>::value &&
-		!std::is_same<typename std::decay<T>::type, const char*>::value &&
-		!std::is_same<typename std::decay<T>::type, char*>::value &&
-		!std::is_pointer<typename std::decay<T>::type>::value,
-		long>::type
-	convert_arg(const T& val) { return static_cast<long>(val); }
-
-	// ָ루ַָ룩ĶףתΪ longָ뱻ַ
-	template<typename T>
-	typename std::enable_if<
-		std::is_pointer<typename std::decay<T>::type>::value &&
-		!std::is_same<typename std::decay<T>::type, const char*>::value &&
-		!std::is_same<typename std::decay<T>::type, char*>::value,
-		long>::type
-	convert_arg(const T& val) { return reinterpret_cast<long>(val); }
-
-	// ʽַ -> %s -> %ld
-	inline const char* fmt_spec(const std::string&) { return "%s"; }
-	inline const char* fmt_spec(const char*)        { return "%s"; }
-	inline const char* fmt_spec(char*)              { return "%s"; }
-	template<size_t N>
-	inline const char* fmt_spec(const char(&)[N])    { return "%s"; }
-	template<size_t N>
-	inline const char* fmt_spec(char(&)[N])          { return "%s"; }
-	template<typename T>
-	typename std::enable_if<
-		!is_string_type<typename std::decay<T>::type>::value &&
-		!std::is_same<typename std::decay<T>::type, const char*>::value &&
-		!std::is_same<typename std::decay<T>::type, char*>::value,
-		const char*>::type
-	fmt_spec(const T&) { return "%ld"; }
-
-	// ޸ĺC++11 ݹ飩
-	template<typename T>
-	void collect_specs(std::string& out, const T& val) {
-		out += fmt_spec(val);
-	}
+//־ڱȥ,Ҳֵ,-DLOG_COMPILE_LEVEL=1ȥdebug־
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL		eLogLevelDebug
+#endif
 
-	template<typename T, typename... Rest>
-	void collect_specs(std::string& out, const T& val, const Rest&... rest) {
-		out += fmt_spec(val);
-		collect_specs(out, rest...);
+//ʱÿռһλ,־ӵ0λʼ,ڴ־һλʼ
+#define LOG_CACHE_SWITCH_SHIFT	(8)
+
+static_assert(DIS_LOG_MAX <= LOG_CACHE_SWITCH_SHIFT && LOG_CACHE_SWITCH_SHIFT + CACHE_LOG_MAX <= 32, "too many log types for the switch mask");
+
+namespace detail_log {
+	constexpr int disk_log_level(int log_type)
+	{
+		return log_type == ASSERT_DISK ? eLogLevelFatal : log_type == ERROR_DISK ? eLogLevelError : eLogLevelDebug;
 	}
 
-	// ղֹ
-	inline void collect_specs(std::string&) {}
-}
-	
-//  vFmt ÿ "{}" ˳滻Ϊ args Ӧ͵ %ld  %s
-template<typename... Args>
-static std::string build_fmt_string(const char* vFmt, const Args&... args)
-{
-	const size_t n = sizeof...(Args);
-	std::string specs;
-	specs.reserve(n * 3);
-	detail_log::collect_specs(specs, args...);
-
-	std::string result;
-	result.reserve(strlen(vFmt) + specs.size());
-	size_t specIdx = 0;
-	for (size_t i = 0; vFmt && vFmt[i] != '\0'; ++i)
+	constexpr int cache_log_level(int log_type)
 	{
-		if (vFmt[i] == '{' && vFmt[i + 1] == '}')
-		{
-			if (specIdx < specs.size())
-			{
-				if (specs[specIdx] == '%' && specs[specIdx + 1] == 'l' && specs[specIdx + 2] == 'd')
-				{
-					result += "%ld";
-					specIdx += 3;
-				}
-				else if (specs[specIdx] == '%' && specs[specIdx + 1] == 's')
-				{
-					result += "%s";
-					specIdx += 2;
-				}
-				else
-				{
-					result += specs[specIdx++];
-				}
-			}
-			else
-			{
-				result += "{}";
-			}
-			++i;
-		}
-		else
-		{
-			result += vFmt[i];
-		}
+		return log_type == DEBUG_CACHE ? eLogLevelDebug : eLogLevelError;
 	}
-	return result;
 }
 
 class CLog : public CSingleton<CLog>
 {
 public:
-	CLog() {};
+	CLog() : m_nEnableMask(0xffffffff), m_nDefaultRate(0), m_nSwitchMask(0xffffffff), m_nLevel(eLogLevelDebug) {};
 	~CLog() {};
+	//nPlaceholderΪʽ"{}"ĸ,DISK_LOG/CACHE_LOGڱ,siteΪõ
+	template<int nPlaceholder, typename... Args>
+	int DiskLog(int log_type, CLogSite& site, const Args &... args);
+	template<int nPlaceholder, typename... Args>
+	int CacheLog(int log_type, CLogSite& site, const Args &... args);
+	//ֵ֮ǰ,ֻһrelaxed
+	bool IsDiskLogOn(int log_type)		{ return (m_nEnableMask.load(std::memory_order_relaxed) >> log_type) & 1; }
+	bool IsCacheLogOn(int log_type)		{ return (m_nEnableMask.load(std::memory_order_relaxed) >> (LOG_CACHE_SWITCH_SHIFT + log_type)) & 1; }
+	//ʱ/رĳ
+	void EnableDiskLog(int log_type, bool bEnable)	{ SetSwitch(log_type, bEnable); }
+	void EnableCacheLog(int log_type, bool bEnable)	{ SetSwitch(LOG_CACHE_SWITCH_SHIFT + log_type, bEnable); }
+	//ʱرյnLevel
+	void SetLogLevel(int nLevel);
+	//ûеָʵĵõÿ,0ʾ
+	void SetDefaultRate(uint32 nRate)	{ m_nDefaultRate.store(nRate, std::memory_order_relaxed); }
+private:
+	template<typename... Args>
+	int Output(int nKind, int log_type, CLogSite& site, const Args &... args);
+	//־߳ʱֻдƼ¼,ͬ
 	template<typename... Args>
-	int DiskLog(int log_type, const char* vFmt, const Args &... args);
+	void Write(int nKind, int log_type, CLogSite& site, const Args &... args);
+	//ͬ:ֱӸʽջϵĶ
 	template<typename... Args>
-	int CacheLog(int log_type, const char* vFmt, const Args &... args);
+	void SyncLog(const char* pName, const char* vFmt, const Args &... args);
+	//õ㱻ѹ
+	void ReportSuppressed(int nKind, int log_type, const CLogSite& site, uint64 nCount);
+	void SetSwitch(int nBit, bool bEnable);
+	//غͼ¼m_nEnableMask,ʱm_configMutex
+	void PublishMask();
+private:
+	std::atomic<uint32>		m_nEnableMask;
+	std::atomic<uint32>		m_nDefaultRate;
+	std::mutex				m_configMutex;
+	uint32					m_nSwitchMask;
+	int						m_nLevel;
 };
 
+#define LOG_CHECK_FORMAT(nPlaceholder, nArgs) \
+	static_assert(nPlaceholder >= 0, "log format has unmatched '{' or '}'"); \
+	static_assert(nPlaceholder == nArgs, "log format {} count does not match argument count")
+
+template<int nPlaceholder, typename... Args>
+int CLog::DiskLog(int log_type, CLogSite& site, const Args &... args)
+{
+	LOG_CHECK_FORMAT(nPlaceholder, (int)sizeof...(Args));
+	return Output(eLogRecordDisk, log_type, site, args...);
+}
+
+template<int nPlaceholder, typename... Args>
+int CLog::CacheLog(int log_type, CLogSite& site, const Args &... args)
+{
+	LOG_CHECK_FORMAT(nPlaceholder, (int)sizeof...(Args));
+	return Output(eLogRecordCache, log_type, site, args...);
+}
+
 template<typename... Args>
-int CLog::DiskLog(int log_type, const char* vFmt, const Args &... args)
+int CLog::Output(int nKind, int log_type, CLogSite& site, const Args &... args)
 {
-	std::string fmt = ::build_fmt_string(vFmt, args...);
-	printf("[%s] ", g_DisLogFile[log_type].second.c_str());
-	printf(fmt.c_str(), detail_log::convert_arg(args)...);
-	printf(" \n");
+	//:ʵֻ,һʱѹ
+	uint32 nRate = site.GetRate() > 0 ? site.GetRate() : m_nDefaultRate.load(std::memory_order_relaxed);
+	if (nRate > 0)
+	{
+		if (!site.TryAcquire(nRate))
+		{
+			return 0;
+		}
+		uint64 nSuppressed = site.TakeSuppressed();
+		if (nSuppressed > 0)
+		{
+			ReportSuppressed(nKind, log_type, site, nSuppressed);
+		}
+	}
+	Write(nKind, log_type, site, args...);
 	return 0;
 }
 
 template<typename... Args>
-int CLog::CacheLog(int log_type, const char* vFmt, const Args &... args)
+void CLog::Write(int nKind, int log_type, CLogSite& site, const Args &... args)
 {
-	std::string fmt = ::build_fmt_string(vFmt, args...);
-	printf("[%s] ", g_CacheLogFile[log_type].second.c_str());
-	printf(fmt.c_str(), detail_log::convert_arg(args)...);
-	printf(" \n");
-	return 0;
+	//־߳ʱֻдƼ¼,ʽ־߳
+	if (CAsyncLog::GetSingletonPtr()->IsRunning())
+	{
+		CAsyncLog::GetSingletonPtr()->Push(nKind, log_type, site, args...);
+		return;
+	}
+	SyncLog(CAsyncLog::GetLogName(nKind, log_type), site.GetFormat(), args...);
+}
+
+template<typename... Args>
+void CLog::SyncLog(const char* pName, const char* vFmt, const Args &... args)
+{
+	CLogLine line;
+	line.Append("[", 1);
+	line.Append(pName);
+	line.Append("] ", 2);
+	detail_log::log_format(line, vFmt, args...);
+	line.Append(" \n", 2);
+	fwrite(line.GetData(), 1, line.GetLen(), stdout);
 }
 
-#define DISK_LOG  CLog::GetSingletonPtr()->DiskLog
-#define CACHE_LOG  CLog::GetSingletonPtr()->CacheLog
+//õ㾲̬,һִʱע,nRateΪÿ
+#define LOG_SITE(vFmt, nRate) \
+	([]() -> CLogSite& { static CLogSite site(vFmt, __FILE__, __LINE__, nRate); return site; }())
 
-#endif //__LOG_H__
+inline void CLog::ReportSuppressed(int nKind, int log_type, const CLogSite& site, uint64 nCount)
+{
+	Write(nKind, log_type, LOG_SITE("[{}:{}] suppressed {} similar messages", 0), site.GetFile(), site.GetLine(), nCount);
+}
 
+inline void CLog::SetSwitch(int nBit, bool bEnable)
+{
+	std::lock_guard<std::mutex> lock(m_configMutex);
+	m_nSwitchMask = bEnable ? (m_nSwitchMask | (1u << nBit)) : (m_nSwitchMask & ~(1u << nBit));
+	PublishMask();
+}
+
+inline void CLog::SetLogLevel(int nLevel)
+{
+	std::lock_guard<std::mutex> lock(m_configMutex);
+	m_nLevel = nLevel;
+	PublishMask();
+}
+
+inline void CLog::PublishMask()
+{
+	uint32 nLevelMask = 0;
+	for (int index = 0; index < DIS_LOG_MAX; index++)
+	{
+		nLevelMask |= detail_log::disk_log_level(index) >= m_nLevel ? (1u << index) : 0;
+	}
+	for (int index = 0; index < CACHE_LOG_MAX; index++)
+	{
+		nLevelMask |= detail_log::cache_log_level(index) >= m_nLevel ? (1u << (LOG_CACHE_SWITCH_SHIFT + index)) : 0;
+	}
+	m_nEnableMask.store(m_nSwitchMask & nLevelMask, std::memory_order_relaxed);
+}
+
+//ʽַ,ڼ"{}"ͲǷһ
+//LOG_COMPILE_LEVELʱǳfalse,־ȥ;ʱرյͲֵ
+#define DISK_LOG_LIMIT(log_type, nRate, vFmt, ...) \
+	((detail_log::disk_log_level(log_type) >= LOG_COMPILE_LEVEL && CLog::GetSingletonPtr()->IsDiskLogOn(log_type)) ? \
+	CLog::GetSingletonPtr()->DiskLog<detail_log::placeholder_count(vFmt)>(log_type, LOG_SITE(vFmt, nRate), ##__VA_ARGS__) : 0)
+#define CACHE_LOG_LIMIT(log_type, nRate, vFmt, ...) \
+	((detail_log::cache_log_level(log_type) >= LOG_COMPILE_LEVEL && CLog::GetSingletonPtr()->IsCacheLogOn(log_type)) ? \
+	CLog::GetSingletonPtr()->CacheLog<detail_log::placeholder_count(vFmt)>(log_type, LOG_SITE(vFmt, nRate), ##__VA_ARGS__) : 0)
+#define DISK_LOG(log_type, vFmt, ...)	DISK_LOG_LIMIT(log_type, 0, vFmt, ##__VA_ARGS__)
+#define CACHE_LOG(log_type, vFmt, ...)	CACHE_LOG_LIMIT(log_type, 0, vFmt, ##__VA_ARGS__)
+
+#endif //__LOG_H__
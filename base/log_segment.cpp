@@ -0,0 +1,181 @@
+#include "log_segment.h"
+#include "async_log.h"
+#include "time_helper.h"
+
+CLogSegmentWriter::CLogSegmentWriter()
+	: m_nSegmentSize(LOG_SEGMENT_SIZE),
+	m_nIndex(0),
+	m_nStartTime(0),
+	m_nUsed(0),
+	m_nSynced(0),
+	m_nWriteBytes(0)
+{
+}
+
+CLogSegmentWriter::~CLogSegmentWriter()
+{
+	Close();
+}
+
+bool CLogSegmentWriter::Open(const char* pPrefix, size_t nSegmentSize)
+{
+	Close();
+	m_Prefix = pPrefix;
+	m_nSegmentSize = MAX(nSegmentSize, (size_t)LOG_RING_SIZE);
+	m_nIndex = 0;
+	m_nStartTime = (uint64)CTimeHelper::GetSingletonPtr()->GetANSITime(true);
+	return OpenSegment();
+}
+
+void CLogSegmentWriter::Close()
+{
+	if (m_File.IsOpen())
+	{
+		m_File.Close(m_nUsed);
+	}
+	m_nUsed = 0;
+	m_nSynced = 0;
+}
+
+bool CLogSegmentWriter::OpenSegment()
+{
+	char szPath[512];
+	snprintf(szPath, sizeof(szPath), "%s.%llu.%u%s", m_Prefix.c_str(), m_nStartTime, m_nIndex, LOG_SEGMENT_SUFFIX);
+	if (!m_File.Open(szPath, m_nSegmentSize))
+	{
+		return false;
+	}
+	CLogSegmentHeader* pHeader = (CLogSegmentHeader*)m_File.GetData();
+	memcpy(pHeader->m_szMagic, LOG_SEGMENT_MAGIC, sizeof(pHeader->m_szMagic));
+	pHeader->m_nVersion = LOG_SEGMENT_VERSION;
+	pHeader->m_nIndex = m_nIndex;
+	pHeader->m_nCreateTime = (uint64)CTimeHelper::GetSingletonPtr()->GetMicroTime(true);
+	pHeader->m_nHeaderSize = sizeof(CLogSegmentHeader);
+	pHeader->m_nReserve = 0;
+	m_nUsed = sizeof(CLogSegmentHeader);
+	m_nSynced = 0;
+	m_nIndex++;
+	m_SiteWritten.clear();
+	return true;
+}
+
+char* CLogSegmentWriter::Reserve(uint32 nSize)
+{
+	if (m_nUsed + nSize > m_File.GetSize())
+	{
+		return NULL;
+	}
+	char* pBuffer = m_File.GetData() + m_nUsed;
+	m_nUsed += nSize;
+	m_nWriteBytes += nSize;
+	return pBuffer;
+}
+
+uint32 CLogSegmentWriter::GetSiteSize(const CLogSite* pSite)
+{
+	return (uint32)LOG_RECORD_ALIGN(sizeof(CLogRecord) +
+		detail_log::log_args_size(pSite->GetFormat(), pSite->GetFile(), (int64)pSite->GetLine()));
+}
+
+bool CLogSegmentWriter::WriteSite(const CLogSite* pSite)
+{
+	uint32 nSize = GetSiteSize(pSite);
+	char* pBuffer = Reserve(nSize);
+	if (pBuffer == NULL)
+	{
+		return false;
+	}
+	CLogRecord* pRecord = (CLogRecord*)pBuffer;
+	memset(pRecord, 0, sizeof(CLogRecord));
+	pRecord->m_nSize = nSize;
+	pRecord->m_nKind = eLogRecordFormat;
+	pRecord->m_nArgCount = 3;
+	pRecord->m_nSiteId = pSite->GetId();
+	detail_log::log_args_encode(pBuffer + sizeof(CLogRecord), pSite->GetFormat(), pSite->GetFile(), (int64)pSite->GetLine());
+	return true;
+}
+
+bool CLogSegmentWriter::Write(const CLogRecord* pRecord)
+{
+	if (!m_File.IsOpen())
+	{
+		return false;
+	}
+	const CLogSite* pSite = NULL;
+	uint32 nSiteSize = 0;
+	if (pRecord->m_nSiteId >= m_SiteWritten.size() || !m_SiteWritten[pRecord->m_nSiteId])
+	{
+		pSite = CLogSite::Find(pRecord->m_nSiteId);
+		nSiteSize = pSite != NULL ? GetSiteSize(pSite) : 0;
+	}
+	if (sizeof(CLogSegmentHeader) + nSiteSize + pRecord->m_nSize > m_File.GetSize())
+	{
+		return false;
+	}
+	//Ų¾ͻһ,¶õҪ¶
+	if (m_nUsed + nSiteSize + pRecord->m_nSize > m_File.GetSize())
+	{
+		m_File.Close(m_nUsed);
+		if (!OpenSegment())
+		{
+			return false;
+		}
+		pSite = CLogSite::Find(pRecord->m_nSiteId);
+		nSiteSize = pSite != NULL ? GetSiteSize(pSite) : 0;
+	}
+	if (pSite != NULL)
+	{
+		WriteSite(pSite);
+		if (pSite->GetId() >= m_SiteWritten.size())
+		{
+			m_SiteWritten.resize(pSite->GetId() + 1, false);
+		}
+		m_SiteWritten[pSite->GetId()] = true;
+	}
+	char* pBuffer = Reserve(pRecord->m_nSize);
+	memcpy(pBuffer, pRecord, pRecord->m_nSize);
+	//ʽָ뿪̾û
+	((CLogRecord*)pBuffer)->m_pFormat = NULL;
+	return true;
+}
+
+bool CLogSegmentWriter::WriteOnCrash(const CLogRecord* pRecord)
+{
+	if (!m_File.IsOpen())
+	{
+		return false;
+	}
+	const CLogSite* pSite = NULL;
+	uint32 nSiteSize = 0;
+	//m_SiteWritten,ųĵõÿ¶,ʱĶ帲ǰ
+	if (pRecord->m_nSiteId >= m_SiteWritten.size() || !m_SiteWritten[pRecord->m_nSiteId])
+	{
+		pSite = CLogSite::TryFind(pRecord->m_nSiteId);
+		nSiteSize = pSite != NULL ? GetSiteSize(pSite) : 0;
+	}
+	if (m_nUsed + nSiteSize + pRecord->m_nSize > m_File.GetSize())
+	{
+		return false;
+	}
+	if (pSite != NULL)
+	{
+		WriteSite(pSite);
+		if (pSite->GetId() < m_SiteWritten.size())
+		{
+			m_SiteWritten[pSite->GetId()] = true;
+		}
+	}
+	char* pBuffer = Reserve(pRecord->m_nSize);
+	memcpy(pBuffer, pRecord, pRecord->m_nSize);
+	((CLogRecord*)pBuffer)->m_pFormat = NULL;
+	return true;
+}
+
+void CLogSegmentWriter::Sync()
+{
+	if (m_File.IsOpen() && m_nUsed > m_nSynced)
+	{
+		m_File.Sync(m_nSynced, m_nUsed - m_nSynced);
+		m_nSynced = m_nUsed;
+	}
+}
@@ -0,0 +1,78 @@
+/*****************************************************************
+* FileName:log_segment.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __LOG_SEGMENT_H__
+#define __LOG_SEGMENT_H__
+
+#include <string>
+#include <vector>
+#include "base.h"
+#include "mmap_file.h"
+
+//־εĬϴС
+#define LOG_SEGMENT_SIZE		(64 * 1024 * 1024)
+#define LOG_SEGMENT_MAGIC		"SFBINLOG"
+#define LOG_SEGMENT_VERSION		(1)
+#define LOG_SEGMENT_SUFFIX		".blog"
+
+struct CLogRecord;
+class CLogSite;
+
+/**
+ * ־ļͷ,ǰ8ֽڶCLogRecord,m_nSizeΪ0ʾ
+ * ÿεһγĳõʱдһeLogRecordFormat¼(ʽļк),֮以
+ * ͨ¼m_pFormatڶ,m_nSiteIdҵʽ
+ */
+struct CLogSegmentHeader
+{
+	char			m_szMagic[8];
+	uint32			m_nVersion;
+	uint32			m_nIndex;			//ͬһڵĶ
+	uint64			m_nCreateTime;		//ʱ(΢)
+	uint32			m_nHeaderSize;
+	uint32			m_nReserve;
+};
+
+/**
+ * ־¼ԭдڴӳ־,дһ,ֻ־߳ʹ
+ * ļΪ ǰ׺.ʱ..blog,tools/log_decoderԭı
+ */
+class CLogSegmentWriter
+{
+public:
+	CLogSegmentWriter();
+	~CLogSegmentWriter();
+	bool	Open(const char* pPrefix, size_t nSegmentSize);
+	void	Close();
+	//дһ¼,falseʾ¼λ󱻶
+	bool	Write(const CLogRecord* pRecord);
+	/**
+	 * ʱд:Ρڴ,õֻһע,Ų¾Ͷ
+	 * Ҫmsync,˳ӳںд
+	 */
+	bool	WriteOnCrash(const CLogRecord* pRecord);
+	//ϴ֮ͬдĲֽں첽д
+	void	Sync();
+	bool	IsOpen()			{ return m_File.IsOpen(); }
+	uint64	GetWriteBytes()		{ return m_nWriteBytes; }
+private:
+	bool	OpenSegment();
+	char*	Reserve(uint32 nSize);
+	bool	WriteSite(const CLogSite* pSite);
+	uint32	GetSiteSize(const CLogSite* pSite);
+private:
+	std::string			m_Prefix;
+	size_t				m_nSegmentSize;
+	uint32				m_nIndex;
+	uint64				m_nStartTime;
+	CMmapFile			m_File;
+	size_t				m_nUsed;
+	size_t				m_nSynced;
+	uint64				m_nWriteBytes;
+	std::vector<bool>	m_SiteWritten;		//ǰѾдĵõ
+};
+
+#endif //__LOG_SEGMENT_H__
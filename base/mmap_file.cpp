@@ -0,0 +1,143 @@
+#include "mmap_file.h"
+#if defined(__LINUX__)
+#include <sys/mman.h>
+#endif
+
+CMmapFile::CMmapFile()
+	: m_pData(NULL),
+	m_nSize(0)
+#if defined(__LINUX__)
+	, m_nFd(-1)
+#else
+	, m_hFile(INVALID_HANDLE_VALUE),
+	m_hMapping(NULL)
+#endif
+{
+}
+
+CMmapFile::~CMmapFile()
+{
+	Close(m_nSize);
+}
+
+#if defined(__LINUX__)
+bool CMmapFile::Open(const char* pPath, size_t nSize)
+{
+	Close(m_nSize);
+	m_nFd = open(pPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_nFd < 0)
+	{
+		return false;
+	}
+	//ȷ̿,дʱΪռ;ļϵͳ֧ʱ˻Ϊϡļ
+	if (posix_fallocate(m_nFd, 0, nSize) != 0 && ftruncate(m_nFd, nSize) != 0)
+	{
+		close(m_nFd);
+		m_nFd = -1;
+		return false;
+	}
+	void* pData = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFd, 0);
+	if (pData == MAP_FAILED)
+	{
+		close(m_nFd);
+		m_nFd = -1;
+		return false;
+	}
+	m_pData = (char*)pData;
+	m_nSize = nSize;
+	return true;
+}
+
+void CMmapFile::Close(size_t nUsed)
+{
+	if (m_pData != NULL)
+	{
+		munmap(m_pData, m_nSize);
+		m_pData = NULL;
+	}
+	if (m_nFd >= 0)
+	{
+		int nRet = ftruncate(m_nFd, MIN(nUsed, m_nSize));
+		(void)nRet;
+		close(m_nFd);
+		m_nFd = -1;
+	}
+	m_nSize = 0;
+}
+
+void CMmapFile::Sync(size_t nOffset, size_t nLen)
+{
+	if (m_pData == NULL || nLen == 0)
+	{
+		return;
+	}
+	//msyncҪʼַҳ
+	size_t nPage = (size_t)sysconf(_SC_PAGESIZE);
+	size_t nBegin = nOffset & ~(nPage - 1);
+	msync(m_pData + nBegin, MIN(nOffset + nLen, m_nSize) - nBegin, MS_ASYNC);
+}
+#else
+bool CMmapFile::Open(const char* pPath, size_t nSize)
+{
+	Close(m_nSize);
+	m_hFile = CreateFileA(pPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	size.QuadPart = (LONGLONG)nSize;
+	m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+	if (m_hMapping == NULL)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	m_pData = (char*)MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, nSize);
+	if (m_pData == NULL)
+	{
+		CloseHandle(m_hMapping);
+		CloseHandle(m_hFile);
+		m_hMapping = NULL;
+		m_hFile = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	m_nSize = nSize;
+	return true;
+}
+
+void CMmapFile::Close(size_t nUsed)
+{
+	if (m_pData != NULL)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = NULL;
+	}
+	if (m_hMapping != NULL)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER size;
+		size.QuadPart = (LONGLONG)MIN(nUsed, m_nSize);
+		SetFilePointerEx(m_hFile, size, NULL, FILE_BEGIN);
+		SetEndOfFile(m_hFile);
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_nSize = 0;
+}
+
+void CMmapFile::Sync(size_t nOffset, size_t nLen)
+{
+	if (m_pData == NULL || nLen == 0)
+	{
+		return;
+	}
+	//FlushViewOfFileֻд,ȴ
+	FlushViewOfFile(m_pData + nOffset, MIN(nLen, m_nSize - nOffset));
+}
+#endif
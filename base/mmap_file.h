@@ -0,0 +1,41 @@
+/*****************************************************************
+* FileName:mmap_file.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __MMAP_FILE_H__
+#define __MMAP_FILE_H__
+
+#include "base.h"
+
+/**
+ * Ԥչ̶Сӳڴļ,дڴ濽
+ * رʱضϵʵдĳ;̱ʱдӳںдļ
+ */
+class CMmapFile
+{
+public:
+	CMmapFile();
+	~CMmapFile();
+	//(Ѵ)ļ,չnSizeֽڲӳ
+	bool	Open(const char* pPath, size_t nSize);
+	//ӳ,ļضϵnUsedֽ
+	void	Close(size_t nUsed);
+	//[nOffset, nOffset + nLen)ں첽д,ȴ
+	void	Sync(size_t nOffset, size_t nLen);
+	char*	GetData()	{ return m_pData; }
+	size_t	GetSize()	{ return m_nSize; }
+	bool	IsOpen()	{ return m_pData != NULL; }
+private:
+	char*			m_pData;
+	size_t			m_nSize;
+#if defined(__LINUX__)
+	int				m_nFd;
+#else
+	HANDLE			m_hFile;
+	HANDLE			m_hMapping;
+#endif
+};
+
+#endif //__MMAP_FILE_H__
@@ -9,7 +9,7 @@
 #define ASSERT(a)                                        \
     if ((a) == false)                                                    \
     {                                                                    \
-        DISK_LOG(ASSERT_DISK,"assert","[{} : {} : {}] ASSERT: ({}) == flase.",    \
+        DISK_LOG(ASSERT_DISK, "[{} : {} : {}] ASSERT: ({}) == flase.",    \
                 __FILE__,__LINE__,__FUNCTION__,#a);                        \
         throw std::logic_error("assert false");\
     }
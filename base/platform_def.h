@@ -31,8 +31,10 @@
 #include <Windows.h>
 #include <WinBase.h>
 #include <WS2tcpip.h>
+#include <malloc.h>
 #endif
 #include <string>
+#include <new>
 using namespace std;
 
 
@@ -46,10 +48,18 @@ using namespace std;
         __asm__ __volatile__("lfence":::"memory")
     #define __WRITE_BARRIER__ \
         __asm__ __volatile__("sfence":::"memory")
+    //ȴʱóˮ,͹Ĳó̵߳һ
+    #if defined(__x86_64__) || defined(__i386__)
+    #define CPU_PAUSE() __builtin_ia32_pause()
+    #elif defined(__aarch64__)
+    #define CPU_PAUSE() __asm__ __volatile__("yield":::"memory")
+    #else
+    #define CPU_PAUSE() do {} while (0)
+    #endif
 
     #define OPT_WOULD_BLOCK   (EAGAIN)
     #define SOCKET_CONNECTING  (EINPROGRESS)
-    #define SLEEP(miseconds) sleep(miseconds)
+    #define SLEEP(miseconds) usleep((miseconds) * 1000)
 	#define INVALID_SM_HADLER (-1)
     #define socket_error (errno)
 
@@ -60,6 +70,9 @@ using namespace std;
 
     //޸ֶ򣬱false sharing ,splitlock
     #define CACHE_LINE_ALIGN  __attribute__((aligned(CACHE_LINE_SIZE)))
+    //ж,aligned_allocҪСǶ
+    #define CACHE_LINE_MALLOC(size) aligned_alloc(CACHE_LINE_SIZE, ((size) + CACHE_LINE_SIZE - 1) & ~((size_t)CACHE_LINE_SIZE - 1))
+    #define CACHE_LINE_FREE(p) free(p)
     // Linux ƽ̨ʹ snprintf Ϊ
     #define sprintf_s(buffer, size, format, ...) snprintf(buffer, size, format, ##__VA_ARGS__)
     #define INVALID_SOCKET          (-1)       
@@ -71,6 +84,7 @@ using namespace std;
     #define __MEM_BARRIER MemoryFence 
     #define __READ_BARRIER__ LoadFence
     #define __WRITE_BARRIER__ StoreFence
+    #define CPU_PAUSE() YieldProcessor()
 
     #define OPT_WOULD_BLOCK   (WSAEWOULDBLOCK)
     #define SOCKET_CONNECTING  (WSAEWOULDBLOCK)
@@ -83,8 +97,48 @@ using namespace std;
     
     //޸ֶ򣬱false sharing ,splitlock
     #define CACHE_LINE_ALIGN __declspec(align(CACHE_LINE_SIZE))
+    #define CACHE_LINE_MALLOC(size) _aligned_malloc(size, CACHE_LINE_SIZE)
+    #define CACHE_LINE_FREE(p) _aligned_free(p)
 #endif
 
+//CACHE_LINE_ALIGNԱc++17֮ǰnewʱ֤,Ϊз
+#define CACHE_LINE_NEW_DELETE \
+	static void* operator new(size_t nSize) \
+	{ \
+		void* p = CACHE_LINE_MALLOC(nSize); \
+		if (p == NULL) \
+		{ \
+			throw std::bad_alloc(); \
+		} \
+		return p; \
+	} \
+	static void operator delete(void* p)	{ CACHE_LINE_FREE(p); }
+
+//жķ,CACHE_LINE_ALIGNԱĶshared_ptrʱstd::allocate_sharedʹ(make_shared֤ͬ)
+template<typename T>
+struct CCacheLineAllocator
+{
+	typedef T value_type;
+	CCacheLineAllocator() {}
+	template<typename U>
+	CCacheLineAllocator(const CCacheLineAllocator<U>&) {}
+	T* allocate(size_t n)
+	{
+		void* p = CACHE_LINE_MALLOC(n * sizeof(T));
+		if (p == NULL)
+		{
+			throw std::bad_alloc();
+		}
+		return (T*)p;
+	}
+	void deallocate(T* p, size_t)	{ CACHE_LINE_FREE(p); }
+};
+
+template<typename T, typename U>
+inline bool operator==(const CCacheLineAllocator<T>&, const CCacheLineAllocator<U>&)	{ return true; }
+template<typename T, typename U>
+inline bool operator!=(const CCacheLineAllocator<T>&, const CCacheLineAllocator<U>&)	{ return false; }
+
 TID  MyGetCurrentThreadID();
 
 #endif //__PLATFORM_DEF_H__
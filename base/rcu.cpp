@@ -0,0 +1,158 @@
+#include "rcu.h"
+
+//ǰ̵߳ļ¼,ûעʱΪNULL
+static thread_local CRcuThreadRecord* g_pRcuRecord = NULL;
+
+CRcu::CRcu()
+	: m_nEpoch(0),
+	m_nPending(0)
+{
+}
+
+CRcu::~CRcu()
+{
+	//˳ʱж
+	for (size_t index = 0; index < m_Retired.size(); index++)
+	{
+		m_Retired[index].m_pDeleter(m_Retired[index].m_pData);
+	}
+	m_Retired.clear();
+	for (size_t index = 0; index < m_Records.size(); index++)
+	{
+		SAFE_DELETE(m_Records[index]);
+	}
+	m_Records.clear();
+}
+
+void CRcu::RegisterThread()
+{
+	if (g_pRcuRecord != NULL)
+	{
+		return;
+	}
+	CRcuThreadRecord* pRecord = NULL;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (size_t index = 0; index < m_Records.size() && pRecord == NULL; index++)
+		{
+			if (!m_Records[index]->m_bUsed.load(std::memory_order_relaxed))
+			{
+				pRecord = m_Records[index];
+			}
+		}
+		if (pRecord == NULL)
+		{
+			pRecord = new CRcuThreadRecord;
+			m_Records.push_back(pRecord);
+		}
+		pRecord->m_nEpoch.store(RCU_OFFLINE, std::memory_order_relaxed);
+		pRecord->m_bUsed.store(true, std::memory_order_relaxed);
+	}
+	g_pRcuRecord = pRecord;
+	Online();
+}
+
+void CRcu::UnregisterThread()
+{
+	CRcuThreadRecord* pRecord = g_pRcuRecord;
+	if (pRecord == NULL)
+	{
+		return;
+	}
+	Offline();
+	g_pRcuRecord = NULL;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	pRecord->m_bUsed.store(false, std::memory_order_relaxed);
+}
+
+void CRcu::Quiescent()
+{
+	CRcuThreadRecord* pRecord = g_pRcuRecord;
+	if (pRecord == NULL)
+	{
+		return;
+	}
+	//ûʱд,¼ڵĻбָɾ
+	uint64 nEpoch = m_nEpoch.load(std::memory_order_acquire);
+	if (pRecord->m_nEpoch.load(std::memory_order_relaxed) != nEpoch)
+	{
+		pRecord->m_nEpoch.store(nEpoch, std::memory_order_release);
+	}
+	if (m_nPending.load(std::memory_order_relaxed) > 0)
+	{
+		Reclaim();
+	}
+}
+
+void CRcu::Offline()
+{
+	CRcuThreadRecord* pRecord = g_pRcuRecord;
+	if (pRecord != NULL)
+	{
+		pRecord->m_nEpoch.store(RCU_OFFLINE, std::memory_order_release);
+	}
+}
+
+void CRcu::Online()
+{
+	CRcuThreadRecord* pRecord = g_pRcuRecord;
+	if (pRecord == NULL)
+	{
+		return;
+	}
+	pRecord->m_nEpoch.store(m_nEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+	//ߵĴָ֮֮ǰԻ߿ɼ,߿ܰ߳
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void CRcu::Retire(void* pData, void (*pDeleter)(void*))
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	CRetired retired;
+	retired.m_pData = pData;
+	retired.m_pDeleter = pDeleter;
+	retired.m_nEpoch = m_nEpoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+	m_Retired.push_back(retired);
+	m_nPending.fetch_add(1, std::memory_order_relaxed);
+}
+
+int CRcu::Reclaim()
+{
+	if (!m_Mutex.try_lock())
+	{
+		return 0;
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	uint64 nMinEpoch = RCU_OFFLINE;
+	for (size_t index = 0; index < m_Records.size(); index++)
+	{
+		CRcuThreadRecord* pRecord = m_Records[index];
+		if (pRecord->m_bUsed.load(std::memory_order_relaxed))
+		{
+			nMinEpoch = MIN(nMinEpoch, pRecord->m_nEpoch.load(std::memory_order_acquire));
+		}
+	}
+	m_Reclaim.clear();
+	for (size_t index = 0; index < m_Retired.size();)
+	{
+		if (m_Retired[index].m_nEpoch <= nMinEpoch)
+		{
+			m_Reclaim.push_back(m_Retired[index]);
+			m_Retired[index] = m_Retired.back();
+			m_Retired.pop_back();
+		}
+		else
+		{
+			index++;
+		}
+	}
+	m_nPending.fetch_sub((uint32)m_Reclaim.size(), std::memory_order_relaxed);
+	for (size_t index = 0; index < m_Reclaim.size(); index++)
+	{
+		m_Reclaim[index].m_pDeleter(m_Reclaim[index].m_pData);
+	}
+	int nCount = (int)m_Reclaim.size();
+	m_Reclaim.clear();
+	m_Mutex.unlock();
+	return nCount;
+}
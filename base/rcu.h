@@ -0,0 +1,113 @@
+/*****************************************************************
+* FileName:rcu.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __RCU_H__
+#define __RCU_H__
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "base.h"
+#include "singleton.h"
+
+//̲߳ڶ(߻ûע)ʱ¼Ĵ
+#define RCU_OFFLINE		((uint64)-1)
+
+//ע̵߳ļ¼,ռһ,ֻ߳д
+struct CRcuThreadRecord
+{
+	std::atomic<uint64>		m_nEpoch;		//һξֹ㿴ȫִ
+	std::atomic_bool		m_bUsed;
+	char					m_Pad[CACHE_LINE_SIZE];	//Ϸ,,̵߳ļ¼
+};
+
+/**
+ * ھֹ(QSBR)RCU:ָֹ֮߳һֱЧ,ʱдκι
+ * д滻ָѾɶ󽻸Retire,ȫִ1;ÿע߳ھֹµǰ,
+ * ̶߳ԽʱĴɶͷ
+ * ߳ҪRegisterThread,CTaskThreadÿConsumeTask֮һֹ
+ */
+class CRcu : public CSingleton<CRcu>
+{
+public:
+	CRcu();
+	~CRcu();
+	//ǰ߳̿ʼ/ʹRCU
+	void	RegisterThread();
+	void	UnregisterThread();
+	//ֹ:ǰ̲߳ٳκRCUָ,˳տͷŵĶ
+	void	Quiescent();
+	//ʱ߻֮ǰOffline,ڼ䲻谭,֮Onlineٶ
+	void	Offline();
+	void	Online();
+	//ӳͷ,ע߳Խֹ֮pDeleter
+	void	Retire(void* pData, void (*pDeleter)(void*));
+	//ͷѾȫĶ,ͷŵĸ;߳ڻʱֱӷ
+	int		Reclaim();
+	//ȴͷŵĶ
+	uint32	GetPendingCount()	{ return m_nPending.load(std::memory_order_relaxed); }
+private:
+	struct CRetired
+	{
+		void*		m_pData;
+		void		(*m_pDeleter)(void*);
+		uint64		m_nEpoch;
+	};
+private:
+	CACHE_LINE_ALIGN std::atomic<uint64>	m_nEpoch;		//ֻRetireʱд,ֹ߳̾ʱ
+	CACHE_LINE_ALIGN std::atomic_uint		m_nPending;
+	std::mutex							m_Mutex;
+	std::vector<CRetired>				m_Retired;
+	std::vector<CRcuThreadRecord*>		m_Records;		//עļ¼Ÿ,ʱͷ
+	std::vector<CRetired>				m_Reclaim;		//ʱʱ,m_Mutexʱʹ
+};
+
+/**
+ * RCUָ:Read/CRcuReadGuard,дPublish¶,ɶӳͷ
+ */
+template<typename T>
+class CRcuPtr
+{
+public:
+	explicit CRcuPtr(T* pData = NULL) : m_pData(pData) {}
+	//ʱж
+	~CRcuPtr()			{ delete m_pData.load(std::memory_order_relaxed); }
+	//ָһֹ֮ǰЧ
+	const T*	Read() const		{ return m_pData.load(std::memory_order_acquire); }
+	//滻¶,д֮䲻Ҫ
+	void		Publish(T* pData)
+	{
+		T* pOld = m_pData.exchange(pData, std::memory_order_acq_rel);
+		if (pOld != NULL)
+		{
+			CRcu::GetSingletonPtr()->Retire(pOld, &CRcuPtr<T>::DeleteData);
+		}
+	}
+private:
+	CRcuPtr(const CRcuPtr&) = delete;
+	CRcuPtr& operator=(const CRcuPtr&) = delete;
+	static void	DeleteData(void* pData)	{ delete (T*)pData; }
+private:
+	std::atomic<T*>		m_pData;
+};
+
+/**
+ * ٽ:QSBR¶߲κд,ֻǱָʹ,ﲻоֹ
+ */
+template<typename T>
+class CRcuReadGuard
+{
+public:
+	CRcuReadGuard() = delete;
+	CRcuReadGuard(const CRcuPtr<T>& rPtr) : m_pData(rPtr.Read()) {}
+	const T*	Get() const				{ return m_pData; }
+	const T*	operator->() const		{ return m_pData; }
+	const T&	operator*() const		{ return *m_pData; }
+private:
+	const T*	m_pData;
+};
+
+#endif //__RCU_H__
@@ -31,87 +31,187 @@
 #include "base.h"
 
 /**
- * ָbadָķʼ⣬ָڴͷ
+ * ģʽ,ʱͨ-DSPO_MODE=Nѡ,Ĭ
+ * :ÿηʶУ־λ,_DEBUG_ٺӰָȶ
+ * :ָÿζ,־λӰָÿSPO_SAMPLE_RATEη(̼߳)Уһ,
+ *			 ̼߳п,ֻ_DEBUG_(Ӱָȶ)ű
+ * ָ:ָֻ,Ҳ,·Ϻָͨ뿪һ
  */
-template<typename Tp>
-class CSafePtr
+#define SPO_MODE_CHECKED	0
+#define SPO_MODE_SAMPLED	1
+#define SPO_MODE_RAW		2
+
+#ifndef SPO_MODE
+#define SPO_MODE			SPO_MODE_CHECKED
+#endif
+
+//ļ,2
+#define SPO_SAMPLE_RATE		64
+
+struct CSafePtrChecked
+{
+	enum { bEncode = 1 };
+	static bool NeedCheck() { return true; }
+};
+
+struct CSafePtrSampled
+{
+	enum { bEncode = 1 };
+	static bool NeedCheck()
+	{
+		static_assert((SPO_SAMPLE_RATE & (SPO_SAMPLE_RATE - 1)) == 0, "SPO_SAMPLE_RATE must be power of 2");
+		static thread_local unsigned int nAccess = 0;
+		return ((++nAccess) & (SPO_SAMPLE_RATE - 1)) == 0;
+	}
+};
+
+struct CSafePtrRaw
+{
+	enum { bEncode = 0 };
+	static bool NeedCheck() { return false; }
+};
+
+#if SPO_MODE == SPO_MODE_CHECKED
+typedef CSafePtrChecked		CSafePtrDefaultPolicy;
+#elif SPO_MODE == SPO_MODE_SAMPLED
+typedef CSafePtrSampled		CSafePtrDefaultPolicy;
+#else
+typedef CSafePtrRaw			CSafePtrDefaultPolicy;
+#endif
+
+/**
+ * ָ밴λ:λnDataL,żλnDataH,һλ־λ
+ * λǹ̶,ֻҪ,Ҫλѭ
+ */
+template<typename Tp, bool bEncode>
+class CSafePtrData
 {
 public:
-	CSafePtr() : nDataH(SPO_FLAG_H), nDataL(SPO_FLAG_L) 
+	CSafePtrData() : nDataH(SPO_FLAG_H), nDataL(SPO_FLAG_L)
 	{
 #ifdef _DEBUG_
 		m_pPointer = NULL;
 #endif 
 	}
-	CSafePtr(Tp* pointer)
+
+	inline void Encode(const Tp* pointer)
 	{
-		nDataH = SPO_FLAG_H;
-		nDataL = SPO_FLAG_L;
 		SPO_DATA_TYPE pvalue = (SPO_DATA_TYPE)pointer;
-		for (size_t index = 0; index < sizeof(void*) * 8;)
-		{
-			nDataL = nDataL | (pvalue & (SPO_MAGIC_NUM >> index)/*ȡҪλ,λΪ*/);//еǰλֵӦλԸ
-			index++;
-			nDataH = nDataH | (pvalue & (SPO_MAGIC_NUM >> index)/*ȡҪλ,λΪ*/);//еǰλֵӦλԸ
-			index++;
-		}
+		nDataL = SPO_FLAG_L | (pvalue & SPO_MAGIC_NUM_L);
+		nDataH = SPO_FLAG_H | (pvalue & SPO_MAGIC_NUM_H);
 #ifdef _DEBUG_
-		m_pPointer = pointer;
+		m_pPointer = const_cast<Tp*>(pointer);
 #endif 
 	}
 
-	CSafePtr<Tp>& operator=(const Tp* pOhter)
+	//_DEBUG_ºӰָȶ
+	inline bool IsShadowMatch(const Tp* pointer) const
 	{
-		Reset(pOhter);
-		return *this;
+#ifdef _DEBUG_
+		return pointer == m_pPointer;
+#else
+		return true;
+#endif 
 	}
 
-	CSafePtr<Tp>& operator=(const CSafePtr<Tp> pOhter)
+	inline Tp* Decode() const
 	{
-		nDataH = pOhter.nDataH;
-		nDataL = pOhter.nDataL;
+		return (Tp*)((nDataL & SPO_MAGIC_NUM_L) | (nDataH & SPO_MAGIC_NUM_H));
+	}
+
+	//־λʱΪ0,ֻһαȽ
+	inline bool IsValid() const
+	{
+		return (((nDataH & SPO_MAGIC_NUM_L) ^ SPO_FLAG_H) | ((nDataL & SPO_MAGIC_NUM_H) ^ SPO_FLAG_L)) == 0;
+	}
+
+	inline bool operator==(const CSafePtrData& other) const
+	{
+		return nDataH == other.nDataH && nDataL == other.nDataL;
+	}
+
+	SPO_DATA_TYPE GetFlagH() const { return nDataH & SPO_MAGIC_NUM_L; }
+	SPO_DATA_TYPE GetFlagL() const { return nDataL & SPO_MAGIC_NUM_H; }
+private:
+	SPO_DATA_TYPE nDataH;
+	SPO_DATA_TYPE nDataL;
 #ifdef _DEBUG_
-		m_pPointer = pOhter.m_pPointer;
+	Tp*			  m_pPointer;
 #endif 
+};
+
+template<typename Tp>
+class CSafePtrData<Tp, false>
+{
+public:
+	CSafePtrData() : m_pPointer(NULL)
+	{}
+
+	inline void Encode(const Tp* pointer)	{ m_pPointer = const_cast<Tp*>(pointer); }
+	inline Tp* Decode() const				{ return m_pPointer; }
+	inline bool IsValid() const				{ return true; }
+	inline bool IsShadowMatch(const Tp*) const { return true; }
+	inline bool operator==(const CSafePtrData& other) const { return m_pPointer == other.m_pPointer; }
+	SPO_DATA_TYPE GetFlagH() const			{ return SPO_FLAG_H; }
+	SPO_DATA_TYPE GetFlagL() const			{ return SPO_FLAG_L; }
+private:
+	Tp*			  m_pPointer;
+};
+
+/**
+ * ָbadָķʼ⣬ָڴͷ
+ */
+template<typename Tp, class Policy = CSafePtrDefaultPolicy>
+class CSafePtr
+{
+	template<typename OtherTp, class OtherPolicy> friend class CSafePtr;
+public:
+	CSafePtr()
+	{}
+	CSafePtr(Tp* pointer)
+	{
+		m_Data.Encode(pointer);
+	}
+
+	//ͬģʽ֮Իת,絥صָģʽֵĬģʽ
+	template<class OtherPolicy>
+	CSafePtr(const CSafePtr<Tp, OtherPolicy>& other)
+	{
+		Tp* pointer = other.GetThrow();
+		m_Data.Encode(pointer);
+	}
+
+	CSafePtr<Tp, Policy>& operator=(const Tp* pOhter)
+	{
+		Reset(pOhter);
+		return *this;
+	}
+
+	CSafePtr<Tp, Policy>& operator=(const CSafePtr<Tp, Policy> pOhter)
+	{
+		m_Data = pOhter.m_Data;
 		return *this;
 	}
 
 	bool IsPointerBad()
 	{
-		char eMsg[256] = { 0 };
 		printf("SafePointer<Tp> FLAGH = 0X%lx,FLAGL = 0X%lx\n", static_cast<unsigned long>(GetFlagH()), static_cast<unsigned long>(GetFlagL()));
-		return  (GetFlagH() != SPO_FLAG_H || GetFlagL() != SPO_FLAG_L);
+		return !m_Data.IsValid();
 	}
 
 	void Reset()
 	{
-		nDataH = SPO_FLAG_H;
-		nDataL = SPO_FLAG_L;
-#ifdef _DEBUG_
-		m_pPointer = NULL;
-#endif 
+		m_Data.Encode(NULL);
 	}
 
 	void Reset(const Tp* pointer)
 	{
-		nDataH = SPO_FLAG_H;
-		nDataL = SPO_FLAG_L;
-		SPO_DATA_TYPE pvalue = (SPO_DATA_TYPE)pointer;
-		for (size_t index = 0; index < sizeof(void*) * 8;)
-		{
-			nDataL = nDataL | (pvalue & (SPO_MAGIC_NUM >> index)/*ȡҪλ,λΪ*/);//еǰλֵӦλԸ
-			index++;
-			nDataH = nDataH | (pvalue & (SPO_MAGIC_NUM >> index)/*ȡҪλ,λΪ*/);//еǰλֵӦλԸ
-			index++;
-		}
-#ifdef _DEBUG_
-		m_pPointer = const_cast<Tp*>(pointer);
-#endif 
+		m_Data.Encode(pointer);
 	}
 
 	//ȡλfag
-	SPO_DATA_TYPE GetFlagH() const { return nDataH & SPO_MAGIC_NUM_L; }
-	SPO_DATA_TYPE GetFlagL() const { return nDataL & SPO_MAGIC_NUM_H; }
+	SPO_DATA_TYPE GetFlagH() const { return m_Data.GetFlagH(); }
+	SPO_DATA_TYPE GetFlagL() const { return m_Data.GetFlagL(); }
 	inline Tp& operator*() const { return *GetThrow(true); }
 	inline Tp* operator->() const { return GetThrow(true); }
 	
@@ -125,14 +225,14 @@ public:
 		return GetThrow() != pOhter;
 	}
 
-	bool operator==(const CSafePtr<Tp> pOhter)
+	bool operator==(const CSafePtr<Tp, Policy> pOhter)
 	{
-		return this->nDataH == pOhter.nDataH && this->nDataL == pOhter.nDataL;
+		return m_Data == pOhter.m_Data;
 	}
 
-	bool operator != (const CSafePtr<Tp> pOhter)
+	bool operator != (const CSafePtr<Tp, Policy> pOhter)
 	{
-		return this->nDataH != pOhter.nDataH && this->nDataL != pOhter.nDataL;
+		return !(m_Data == pOhter.m_Data);
 	}
 
 	Tp* operator()()
@@ -155,12 +255,12 @@ public:
 	}
 
 	template<typename NewTp>
-	void StaticCastTo()
+	CSafePtr<NewTp> StaticCastTo()
 	{
 		Tp* pPointer = GetThrow();
 		if (pPointer != NULL)
 		{
-			return CSafePtr<NewTp>(static_cast<NewTp>(pPointer));
+			return CSafePtr<NewTp>(static_cast<NewTp*>(pPointer));
 		}
 		else
 		{
@@ -177,44 +277,39 @@ public:
 	{
 		Tp* pPointer = GetThrow();
 		SAFE_DELETE(pPointer);
-		nDataH = SPO_FLAG_H;
-		nDataL = SPO_FLAG_L;
-#ifdef _DEBUG_
-		m_pPointer = NULL;
-#endif 
+		m_Data.Encode(NULL);
 	}
 private:
 	Tp* GetThrow(bool nullcheck = false) const
 	{
-		Tp* pPoint = (Tp*)((nDataL & SPO_MAGIC_NUM_L) | (nDataH & SPO_MAGIC_NUM_H));
-		if (GetFlagH() != SPO_FLAG_H || GetFlagL() != SPO_FLAG_L)
+		Tp* pPoint = m_Data.Decode();
+		if (Policy::bEncode && Policy::NeedCheck())
 		{
-			char eMsg[256] = { 0 };
-			sprintf_s(eMsg,256,SPO_ERROR_MSG, (unsigned long)(GetFlagH()), (unsigned long)GetFlagL(), (void*)pPoint);
-			throw std::runtime_error(eMsg);
+			if (!m_Data.IsValid())
+			{
+				char eMsg[256] = { 0 };
+				sprintf_s(eMsg,256,SPO_ERROR_MSG, (unsigned long)(GetFlagH()), (unsigned long)GetFlagL(), (void*)pPoint);
+				throw std::runtime_error(eMsg);
+			}
+#ifdef _DEBUG_
+			if (!m_Data.IsShadowMatch(pPoint))
+			{
+				throw std::runtime_error("pointer is bad pPoint != m_pPointer");
+			}
+#endif 
 		}
 
-		if (nullcheck && pPoint == NULL)
+		if (Policy::bEncode && nullcheck && pPoint == NULL)
 		{
 			char eMsg[256] = { 0 };
 			sprintf_s(eMsg,256, SPO_ERROR_MSG, (unsigned long)GetFlagH(), (unsigned long)GetFlagL(), (void*)pPoint);
 			throw std::runtime_error(eMsg);
 		}
-#ifdef _DEBUG_
-		if (pPoint != m_pPointer)
-		{
-			throw std::runtime_error("pointer is bad pPoint != m_pPointer");
-		}
-#endif 
 		return pPoint;
 	}
 
 private:
-	SPO_DATA_TYPE nDataH;
-	SPO_DATA_TYPE nDataL;
-#ifdef _DEBUG_
-	Tp*			  m_pPointer;
-#endif 
+	CSafePtrData<Tp, Policy::bEncode != 0>	m_Data;
 };
 
 #endif //__SAFE_POINTER_H__
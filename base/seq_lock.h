@@ -0,0 +1,82 @@
+/*****************************************************************
+* FileName:seq_lock.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __SEQ_LOCK_H__
+#define __SEQ_LOCK_H__
+
+#include <atomic>
+#include <type_traits>
+#include <string.h>
+#include "base.h"
+
+/**
+ * ˳:СPOD(Ԫݵ),д
+ * ֻд:šݡٶ,Ϊǰһ¾ض
+ * д߰CAS(д֮以),дټ1;ݰ64λԭִ,дʱûݾ
+ */
+template<typename T>
+class CSeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "CSeqLock only holds trivially copyable data");
+public:
+	CSeqLock() : m_nSeq(0)
+	{
+		for (int index = 0; index < WORD_COUNT; index++)
+		{
+			m_Data[index].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	explicit CSeqLock(const T& value) : CSeqLock()
+	{
+		Write(value);
+	}
+
+	T		Read() const
+	{
+		uint64 words[WORD_COUNT];
+		uint32 nSeq = 0;
+		do
+		{
+			while ((nSeq = m_nSeq.load(std::memory_order_acquire)) & 1)
+			{
+				CPU_PAUSE();
+			}
+			for (int index = 0; index < WORD_COUNT; index++)
+			{
+				words[index] = m_Data[index].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while (m_nSeq.load(std::memory_order_relaxed) != nSeq);
+		T value;
+		memcpy(&value, words, sizeof(T));
+		return value;
+	}
+
+	void	Write(const T& value)
+	{
+		uint64 words[WORD_COUNT] = { 0 };
+		memcpy(words, &value, sizeof(T));
+		uint32 nSeq = m_nSeq.load(std::memory_order_relaxed);
+		while ((nSeq & 1) || !m_nSeq.compare_exchange_weak(nSeq, nSeq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			CPU_PAUSE();
+			nSeq = m_nSeq.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		for (int index = 0; index < WORD_COUNT; index++)
+		{
+			m_Data[index].store(words[index], std::memory_order_relaxed);
+		}
+		m_nSeq.store(nSeq + 2, std::memory_order_release);
+	}
+private:
+	enum { WORD_COUNT = (sizeof(T) + sizeof(uint64) - 1) / sizeof(uint64) };
+	std::atomic<uint32>		m_nSeq;
+	std::atomic<uint64>		m_Data[WORD_COUNT];
+};
+
+#endif //__SEQ_LOCK_H__
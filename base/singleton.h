@@ -22,7 +22,8 @@ private:
 	CSingleton(const CSingleton &temp) = delete;
 	CSingleton &operator=(const CSingleton &temp) = delete;
 public:
-	static CSafePtr<T> GetSingletonPtr()
+	//̬ĵַǿָҲʧЧ,ָģʽ,CLog/CTimeHelper·ϲͼ
+	static CSafePtr<T, CSafePtrRaw> GetSingletonPtr()
 	{
 	//ʵ֣߳µĳʼֻc++11ϵı֤ȫȷ
 	/*ֲ̬̰߳ȫԵһ̵߳ʱúڲֲ̬C++11׼ȷ¼㣺
@@ -1,11 +1,175 @@
+#include <thread>
 #include "time_helper.h"
-#include "my_thread.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define TSC_SUPPORTED
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define TSC_SUPPORTED
+#endif
 
 using namespace std;
 using namespace std::chrono;
 
+//TSCУ׼Ĳʱ()
+#define TSC_CALIBRATE_TIME		20
+//У׼ʱÿ˵ȡĴ
+#define TSC_CALIBRATE_SAMPLE	16
+
+CTscClock::CCalibration::CCalibration()
+	: m_bTsc(false),
+	m_nBaseTick(0),
+	m_nBaseNs(0),
+	m_fNsPerTick(0)
+{
+	if (!IsTscInvariant())
+	{
+		return;
+	}
+	uint64 nBeginTick = 0;
+	uint64 nBeginNs = 0;
+	ReadClockPair(nBeginTick, nBeginNs);
+	std::this_thread::sleep_for(std::chrono::milliseconds(TSC_CALIBRATE_TIME));
+	uint64 nEndTick = 0;
+	uint64 nEndNs = 0;
+	ReadClockPair(nEndTick, nEndNs);
+	if (nEndTick <= nBeginTick || nEndNs <= nBeginNs)
+	{
+		return;
+	}
+	m_fNsPerTick = (double)(nEndNs - nBeginNs) / (double)(nEndTick - nBeginTick);
+	m_nBaseTick = nEndTick;
+	m_nBaseNs = nEndNs;
+	m_bTsc = true;
+}
+
+void CTscClock::ReadClockPair(uint64& nTick, uint64& nNs)
+{
+	//TSCסһCLOCK_MONOTONICȡ,ȡСһ,TSCȡе,ٶȡ֮䱻ϴ
+	uint64 nMinGap = (uint64)-1;
+	for (int index = 0; index < TSC_CALIBRATE_SAMPLE; index++)
+	{
+		uint64 nBefore = ReadTsc();
+		uint64 nMonotonic = MonotonicNs();
+		uint64 nAfter = ReadTsc();
+		if (nAfter - nBefore < nMinGap)
+		{
+			nMinGap = nAfter - nBefore;
+			nTick = nBefore + (nAfter - nBefore) / 2;
+			nNs = nMonotonic;
+		}
+	}
+}
+
+const CTscClock::CCalibration& CTscClock::GetCalibration()
+{
+	//һʹʱУ׼,ֻ֮
+	static CCalibration calibration;
+	return calibration;
+}
+
+uint64 CTscClock::NowNs()
+{
+	const CCalibration& calibration = GetCalibration();
+	if (!calibration.m_bTsc)
+	{
+		return MonotonicNs();
+	}
+	uint64 nTick = ReadTsc();
+	//ͬĵTSC΢Сƫ,У׼ʱУ׼,޷
+	if (nTick <= calibration.m_nBaseTick)
+	{
+		return calibration.m_nBaseNs;
+	}
+	return calibration.m_nBaseNs + (uint64)((double)(nTick - calibration.m_nBaseTick) * calibration.m_fNsPerTick);
+}
+
+uint64 CTscClock::MonotonicNs()
+{
+#if defined(__LINUX__)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000ULL + (uint64)ts.tv_nsec;
+#else
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void CTscClock::SleepUntilNs(uint64 nDeadlineNs, uint64 nSpinNs)
+{
+	uint64 nNow = MonotonicNs();
+	if (nNow + nSpinNs < nDeadlineNs)
+	{
+#if defined(__LINUX__)
+		uint64 nWake = nDeadlineNs - nSpinNs;
+		struct timespec ts;
+		ts.tv_sec = (time_t)(nWake / 1000000000ULL);
+		ts.tv_nsec = (long)(nWake % 1000000000ULL);
+		//źŴʱͬһʱ˯
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		{
+		}
+#else
+		this_thread::sleep_for(nanoseconds(nDeadlineNs - nSpinNs - nNow));
+#endif
+	}
+	while (MonotonicNs() < nDeadlineNs)
+	{
+		CPU_PAUSE();
+	}
+}
+
+bool CTscClock::IsTscInvariant()
+{
+#if defined(TSC_SUPPORTED)
+	//CPUID.80000007H:EDX[8] 㶨TSC,ƵʲƵC״̬仯
+#if defined(_MSC_VER)
+	int regs[4] = { 0 };
+	__cpuid(regs, 0x80000000);
+	if ((unsigned int)regs[0] < 0x80000007)
+	{
+		return false;
+	}
+	__cpuid(regs, 0x80000007);
+	return (regs[3] & (1 << 8)) != 0;
+#else
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+	{
+		return false;
+	}
+	__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+	return (edx & (1 << 8)) != 0;
+#endif
+#else
+	return false;
+#endif
+}
+
+uint64 CTscClock::ReadTsc()
+{
+#if defined(TSC_SUPPORTED)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
 CTimeHelper::CTimeHelper()
+	: m_nMonoMicroTime(0),
+	m_nWallOffset(0),
+	m_nCalendarSeq(0),
+	m_bClockService(false),
+	m_nLastSecond(0),
+	m_nHourStart(0)
 {
+	m_bUpdating.clear();
+	for (int index = 0; index < eCalendarFieldCount; index++)
+	{
+		m_CalendarField[index].store(0, std::memory_order_relaxed);
+	}
+	Tick();
 }
 
 CTimeHelper::~CTimeHelper()
@@ -17,9 +181,9 @@ time_t CTimeHelper::GetANSITime(bool realTime)
 {
 	if (realTime)
 	{
-		SetTime();
+		return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 	}
-	return std::chrono::system_clock::to_time_t(g_thread_data.m_CacheTimePoint);
+	return GetMicroTime() / 1000000;
 }
 
 //
@@ -27,26 +191,100 @@ uint64 CTimeHelper::GetMSTime(bool realTime)
 {
 	if (realTime)
 	{
-		SetTime();
+		return CTscClock::MonotonicNs() / 1000000;
 	}
-	return duration_cast<milliseconds>(g_thread_data.m_CacheTimePoint.time_since_epoch()).count();
+	return m_nMonoMicroTime.load(std::memory_order_acquire) / 1000;
 }
 
 time_t CTimeHelper::GetMicroTime(bool realTime)
 {
 	if (realTime)
 	{
-		SetTime();
+		return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
 	}
-	return duration_cast<microseconds>(g_thread_data.m_CacheTimePoint.time_since_epoch()).count();
+	uint64 nMonoMicroTime = m_nMonoMicroTime.load(std::memory_order_acquire);
+	return (time_t)((int64)nMonoMicroTime + m_nWallOffset.load(std::memory_order_relaxed));
 }
 
 void CTimeHelper::SetTime()
 {
-	g_thread_data.m_CacheTimePoint = std::chrono::system_clock::now();
-	time_t nowTime = std::chrono::system_clock::to_time_t(g_thread_data.m_CacheTimePoint);
-	std::tm ptm = LocalTime(nowTime);//std::tmĽṹ
-	g_thread_data.m_CacheTime = ptm;
+	//ʱӷ,ͳһ
+	if (m_bClockService.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	Tick();
+}
+
+void CTimeHelper::Tick()
+{
+	//Ѿ߳ڸ,ֱʱ
+	if (m_bUpdating.test_and_set(std::memory_order_acquire))
+	{
+		return;
+	}
+	uint64 nMonoMicroTime = CTscClock::MonotonicNs() / 1000;
+	int64 nWallMicroTime = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+	//ǽʱֻıƫ,ʱճǰ
+	m_nWallOffset.store(nWallMicroTime - (int64)nMonoMicroTime, std::memory_order_relaxed);
+	m_nMonoMicroTime.store(nMonoMicroTime, std::memory_order_release);
+
+	time_t nSecond = (time_t)(nWallMicroTime / 1000000);
+	if (nSecond != m_nLastSecond)
+	{
+		m_nLastSecond = nSecond;
+		time_t nSecondOfHour = nSecond - m_nHourStart;
+		if (m_nHourStart == 0 || nSecondOfHour < 0 || nSecondOfHour >= 3600)
+		{
+			//Сʱ(졢ʱл)·ֽ
+			m_LastCalendar = LocalTime(nSecond);
+			m_nHourStart = nSecond - m_LastCalendar.tm_min * 60 - m_LastCalendar.tm_sec;
+		}
+		else
+		{
+			m_LastCalendar.tm_min = (int)(nSecondOfHour / 60);
+			m_LastCalendar.tm_sec = (int)(nSecondOfHour % 60);
+		}
+		PublishCalendar(m_LastCalendar);
+	}
+	m_bUpdating.clear(std::memory_order_release);
+}
+
+void CTimeHelper::PublishCalendar(const std::tm& tm)
+{
+	unsigned int nSeq = m_nCalendarSeq.load(std::memory_order_relaxed);
+	m_nCalendarSeq.store(nSeq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_CalendarField[eCalendarYear].store(tm.tm_year, std::memory_order_relaxed);
+	m_CalendarField[eCalendarMonth].store(tm.tm_mon, std::memory_order_relaxed);
+	m_CalendarField[eCalendarDay].store(tm.tm_mday, std::memory_order_relaxed);
+	m_CalendarField[eCalendarHour].store(tm.tm_hour, std::memory_order_relaxed);
+	m_CalendarField[eCalendarMinute].store(tm.tm_min, std::memory_order_relaxed);
+	m_CalendarField[eCalendarSecond].store(tm.tm_sec, std::memory_order_relaxed);
+	m_CalendarField[eCalendarWeek].store(tm.tm_wday, std::memory_order_relaxed);
+	m_CalendarField[eCalendarDayOfYear].store(tm.tm_yday, std::memory_order_relaxed);
+	m_nCalendarSeq.store(nSeq + 2, std::memory_order_release);
+}
+
+void CTimeHelper::GetCalendar(std::tm& tm)
+{
+	unsigned int nSeqBegin = 0;
+	unsigned int nSeqEnd = 0;
+	do 
+	{
+		nSeqBegin = m_nCalendarSeq.load(std::memory_order_acquire);
+		tm.tm_year = GetCalendarField(eCalendarYear);
+		tm.tm_mon = GetCalendarField(eCalendarMonth);
+		tm.tm_mday = GetCalendarField(eCalendarDay);
+		tm.tm_hour = GetCalendarField(eCalendarHour);
+		tm.tm_min = GetCalendarField(eCalendarMinute);
+		tm.tm_sec = GetCalendarField(eCalendarSecond);
+		tm.tm_wday = GetCalendarField(eCalendarWeek);
+		tm.tm_yday = GetCalendarField(eCalendarDayOfYear);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		nSeqEnd = m_nCalendarSeq.load(std::memory_order_relaxed);
+	} while ((nSeqBegin & 1) != 0 || nSeqBegin != nSeqEnd);
+	tm.tm_isdst = -1;
 }
 
 std::tm CTimeHelper::LocalTime( std::time_t& time_tt)
@@ -80,43 +318,43 @@ int CTimeHelper::DiffWeek(time_t tm1, time_t tm2)
 
 int CTimeHelper::GetDayOfYear()
 {
-	return g_thread_data.m_CacheTime.tm_yday;
+	return GetCalendarField(eCalendarDayOfYear);
 }
 
 int CTimeHelper::GetYear()
 {
-	return g_thread_data.m_CacheTime.tm_year + 1900;
+	return GetCalendarField(eCalendarYear) + 1900;
 }	//[1900,????]
 
 int CTimeHelper::GetMonth()
 {
-	return g_thread_data.m_CacheTime.tm_mon;
+	return GetCalendarField(eCalendarMonth);
 }		//[0,11]
 
 int CTimeHelper::GetDay()
 {
-	return g_thread_data.m_CacheTime.tm_mday;
+	return GetCalendarField(eCalendarDay);
 }		//[1,31]
 
 int CTimeHelper::GetHour()
 {
-	return g_thread_data.m_CacheTime.tm_hour;
+	return GetCalendarField(eCalendarHour);
 }		//[0,23]
 
 int CTimeHelper::GetMinute()
 {
-	return g_thread_data.m_CacheTime.tm_min;
+	return GetCalendarField(eCalendarMinute);
 }		//[0,59]
 
 int CTimeHelper::GetSecond()
 {
-	return g_thread_data.m_CacheTime.tm_sec;
+	return GetCalendarField(eCalendarSecond);
 }		//[0,59]
 
 //ȡõǰڼ0ʾ죬16ʾһ
 int  CTimeHelper::GetWeek()
 {
-	return g_thread_data.m_CacheTime.tm_wday;
+	return GetCalendarField(eCalendarWeek);
 }
 
 //ж
@@ -140,9 +378,12 @@ int CTimeHelper::GetMonthDay(int year,int month)
 //20260306תΪ̶ʽYYYYMMDD
 unsigned int CTimeHelper::Time2Day()
 {
-	unsigned int year = GetYear();
-	unsigned int month = GetMonth() + 1;
-	unsigned int day = GetDay();
+	//Ҫȡͬһݿ,ʱƴ
+	std::tm tm;
+	GetCalendar(tm);
+	unsigned int year = tm.tm_year + 1900;
+	unsigned int month = tm.tm_mon + 1;
+	unsigned int day = tm.tm_mday;
 	return year * 10000 + month * 100 + day;
 }
 
@@ -10,11 +10,37 @@
 #include <ctime>
 #include <ratio>
 #include <map>
+#include <atomic>
 #include "base.h"
 #include "singleton.h"
 
 typedef std::chrono::time_point<std::chrono::system_clock> TimePoint;
 
+//ʱӷĬϵĸ¾()
+#define CLOCK_DEFAULT_RESOLUTION	1
+//ȷ˯ȴʱ(),ں˶ʱĻӳ
+#define CLOCK_SLEEP_SPIN_NS			(200 * 1000)
+
+//յֶ,std::tmӦֶһ
+enum enCalendarField
+{
+	eCalendarYear = 0,		//tm_year
+	eCalendarMonth,			//tm_mon
+	eCalendarDay,			//tm_mday
+	eCalendarHour,			//tm_hour
+	eCalendarMinute,		//tm_min
+	eCalendarSecond,		//tm_sec
+	eCalendarWeek,			//tm_wday
+	eCalendarDayOfYear,		//tm_yday
+	eCalendarFieldCount,
+};
+
+/**
+ * ȫֻʱ:ֻһ(ʱӷ߳CClockThread,ûʱɵSetTime߳ռ)Tickʱ
+ * ʱȡԵʱ(CTscClock::MonotonicNs),ֻʱ,ǽʱ䲻Ӱ;ǽʱڵʱ
+ * ÿTick²ƫ,ϵͳʱ(ز);seqlock,ǽʱ仯ʱŸ,
+ * Сʱ仯ʱŵlocaltime·ֽ(ͬʱǿʱл),ȡʱûϵͳ
+ */
 class CTimeHelper : public CSingleton<CTimeHelper>
 {
 public:
@@ -23,12 +49,18 @@ public:
 
 	//ʱ1970010100ʱ0000(ʱ1970010108ʱ0000)ڵ
 	time_t			GetANSITime(bool realTime = false);
-	//
+	//ʱ,ǽʱ޹,ֻʱʱ͵ʱ
 	uint64			GetMSTime(bool realTime = false);
-	//΢
+	//ǽʱ΢(1970)
 	time_t			GetMicroTime(bool realTime = false);
-	//»ʱ
+	//»ʱ,ʱӷʱʲôҲ
 	void			SetTime();
+	//ǰʱ,ͬһʱֻһ
+	void			Tick();
+	//ʱӷ/ֹͣʱ,SetTimeٸʱ
+	void			SetClockService(bool bRunning)	{ m_bClockService.store(bRunning, std::memory_order_release); }
+	//ȡһһµ
+	void			GetCalendar(std::tm& tm);
 	//ȡʱʱġꡢ¡աСʱ֡롢ڵֵ
 	int				GetYear();	//[1900,????]
 	int				GetMonth();		//[0,11]
@@ -51,8 +83,61 @@ public:
 	int 			GetMonthDay(int year,int month);
 	//20260306ںµ
 	unsigned int    Time2DayAfter(unsigned int time2day,int diffDay);
+private:
+	//ѷֽõд
+	void			PublishCalendar(const std::tm& tm);
+	int				GetCalendarField(enCalendarField field) { return m_CalendarField[field].load(std::memory_order_relaxed); }
+private:
+	std::atomic<uint64>			m_nMonoMicroTime;	//ĵ΢ʱ
+	std::atomic<int64>			m_nWallOffset;		//ǽ΢ʱȥ΢ʱ
+	std::atomic_uint			m_nCalendarSeq;		//յ,ʾд
+	std::atomic_int				m_CalendarField[eCalendarFieldCount];
+	std::atomic_bool			m_bClockService;
+	std::atomic_flag			m_bUpdating;
+	//ֻи߷
+	time_t						m_nLastSecond;		//ϴη
+	time_t						m_nHourStart;		//ǰСʱʼ
+	std::tm						m_LastCalendar;
 };
 
+/**
+ * ʱ,ֻʱ,ǽʱ޹
+ * x86TSC㶨(invariant)ʱrdtsc,ʱCLOCK_MONOTONICУ׼,㵽ͬһʱ;
+ * ˻Ϊclock_gettime(CLOCK_MONOTONIC)(WindowsΪsteady_clock)
+ */
+class CTscClock
+{
+public:
+	//ǰʱ
+	static uint64	NowNs();
+	//ǰʱ
+	static uint64	NowMs()			{ return NowNs() / 1000000; }
+	//ǷʹTSC
+	static bool		IsTscEnabled()	{ return GetCalibration().m_bTsc; }
+	//ÿTSCڵ,ûʹTSCʱΪ0
+	static double	GetNsPerTick()	{ return GetCalibration().m_fNsPerTick; }
+	//ֱӶCLOCK_MONOTONIC
+	static uint64	MonotonicNs();
+	/**
+	 * ˯MonotonicNs()ʱϵľʱnDeadlineNs,Linuxclock_nanosleep(TIMER_ABSTIME)˯ֹǰnSpinNs,
+	 * ֹʱ,΢뼶;ʱ˯,ÿ֡ۻ
+	 */
+	static void		SleepUntilNs(uint64 nDeadlineNs, uint64 nSpinNs = CLOCK_SLEEP_SPIN_NS);
+private:
+	struct CCalibration
+	{
+		CCalibration();
+		bool		m_bTsc;
+		uint64		m_nBaseTick;	//У׼ʱTSC
+		uint64		m_nBaseNs;		//У׼ʱCLOCK_MONOTONIC
+		double		m_fNsPerTick;
+	};
+	static const CCalibration& GetCalibration();
+	//ͬʱȡһTSCCLOCK_MONOTONIC
+	static void		ReadClockPair(uint64& nTick, uint64& nNs);
+	static bool		IsTscInvariant();
+	static uint64	ReadTsc();
+};
 
 class CMyTimer
 {
@@ -72,6 +157,12 @@ public:
 		mDuration = vDuration;
 	}
 
+	//CTscClockĵʱʱ,ǽʱӰ
+	void BeginTimer(time_t vDuration)
+	{
+		BeginTimer((time_t)CTscClock::NowMs(), vDuration);
+	}
+
 public:
 	// 뵱ǰʱ䣨룩Ƿʱʱһγʱʱ䣬
 	inline bool IsTimeout(time_t tNow)
@@ -97,6 +188,12 @@ public:
 		return false;
 	}
 
+	// CTscClockĵʱжǷʱ
+	inline bool IsTimeout()
+	{
+		return IsTimeout((time_t)CTscClock::NowMs());
+	}
+
 	// timerʱʱ
 	void ResetTimeout(time_t tNow)
 	{
@@ -0,0 +1,58 @@
+#include <thread>
+#include "clock_thread.h"
+
+CClockThread::CClockThread()
+	: m_bStarted(false),
+	m_nResolution(CLOCK_DEFAULT_RESOLUTION)
+{
+	//֤CTimeHelperʱ̹߳,ʱ߳
+	CTimeHelper::GetSingletonPtr();
+}
+
+CClockThread::~CClockThread()
+{
+	StopClock();
+}
+
+bool CClockThread::PrepareToRun()
+{
+	return true;
+}
+
+bool CClockThread::PrepareEnd()
+{
+	return true;
+}
+
+void CClockThread::Run()
+{
+	while (!IsStoped())
+	{
+		CTimeHelper::GetSingletonPtr()->Tick();
+		std::this_thread::sleep_for(std::chrono::milliseconds(m_nResolution));
+	}
+}
+
+void CClockThread::StartClock(int nResolution)
+{
+	bool bExpected = false;
+	if (!m_bStarted.compare_exchange_strong(bExpected, true))
+	{
+		return;
+	}
+	m_nResolution = nResolution > 0 ? nResolution : CLOCK_DEFAULT_RESOLUTION;
+	CTimeHelper::GetSingletonPtr()->Tick();
+	CTimeHelper::GetSingletonPtr()->SetClockService(true);
+	CreateThread();
+}
+
+void CClockThread::StopClock()
+{
+	if (!m_bStarted.load() || IsStoped())
+	{
+		return;
+	}
+	Stop();
+	Join();
+	CTimeHelper::GetSingletonPtr()->SetClockService(false);
+}
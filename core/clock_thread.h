@@ -0,0 +1,34 @@
+/*****************************************************************
+* FileName:clock_thread.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __CLOCK_THREAD_H__
+#define __CLOCK_THREAD_H__
+
+#include "my_thread.h"
+#include "singleton.h"
+
+/**
+ * ʱӷ߳,̶ȵCTimeHelper::Tickʱ,ֻһ
+ * ֮߳ÿֵSetTimeٶϵͳʱ,Ҳٵlocaltime
+ */
+class CClockThread : public CMyThread, public CSingleton<CClockThread>
+{
+public:
+	CClockThread();
+	virtual ~CClockThread();
+	virtual bool PrepareToRun();
+	virtual bool PrepareEnd();
+	virtual void Run();
+	//ʱӷ,nResolutionΪ¾(),εֻһ
+	void StartClock(int nResolution = CLOCK_DEFAULT_RESOLUTION);
+	//ֹͣʱӷ,֮ɵSetTime̸߳ʱ,ֹͣٴ
+	void StopClock();
+private:
+	std::atomic_bool	m_bStarted;
+	int					m_nResolution;
+};
+
+#endif //__CLOCK_THREAD_H__
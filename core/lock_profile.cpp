@@ -0,0 +1,196 @@
+#include "lock_profile.h"
+
+#if defined(LOCK_PROFILE_ON)
+#include <algorithm>
+#include "time_helper.h"
+#include "log.h"
+
+static thread_local CLockThreadStats* g_pLockThreadStats = NULL;
+
+//һд,ȶд
+static inline void AddStat(std::atomic<uint64>& rStat, uint64 nValue)
+{
+	rStat.store(rStat.load(std::memory_order_relaxed) + nValue, std::memory_order_relaxed);
+}
+
+static inline void MaxStat(std::atomic<uint64>& rStat, uint64 nValue)
+{
+	if (nValue > rStat.load(std::memory_order_relaxed))
+	{
+		rStat.store(nValue, std::memory_order_relaxed);
+	}
+}
+
+CLockProfile::CLockProfile()
+{
+}
+
+CLockProfile::~CLockProfile()
+{
+	for (size_t index = 0; index < m_Threads.size(); index++)
+	{
+		SAFE_DELETE(m_Threads[index]);
+	}
+	m_Threads.clear();
+}
+
+int CLockProfile::GetNameId(const char* pName)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::string name = pName != NULL ? pName : "unnamed";
+	auto it = m_NameIds.find(name);
+	if (it != m_NameIds.end())
+	{
+		return it->second;
+	}
+	if (m_Names.size() >= LOCK_PROFILE_MAX_NAME - 1)
+	{
+		//һ޵
+		if (m_Names.size() == LOCK_PROFILE_MAX_NAME - 1)
+		{
+			m_Names.push_back("others");
+		}
+		return LOCK_PROFILE_MAX_NAME - 1;
+	}
+	int nId = (int)m_Names.size();
+	m_Names.push_back(name);
+	m_NameIds[name] = nId;
+	return nId;
+}
+
+CLockThreadStats* CLockProfile::GetThreadStats()
+{
+	if (g_pLockThreadStats == NULL)
+	{
+		CLockThreadStats* pStats = new CLockThreadStats();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Threads.push_back(pStats);
+		g_pLockThreadStats = pStats;
+	}
+	return g_pLockThreadStats;
+}
+
+void CLockProfile::GetReport(std::vector<CLockReport>& rReport)
+{
+	rReport.clear();
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (size_t nId = 0; nId < m_Names.size(); nId++)
+	{
+		CLockReport report;
+		report.m_Name = m_Names[nId];
+		report.m_nAcquire = 0;
+		report.m_nContended = 0;
+		report.m_nWaitNs = 0;
+		report.m_nMaxWaitNs = 0;
+		report.m_nHoldNs = 0;
+		report.m_nMaxHoldNs = 0;
+		for (size_t index = 0; index < m_Threads.size(); index++)
+		{
+			CLockStat& stat = m_Threads[index]->m_Stats[nId];
+			report.m_nAcquire += stat.m_nAcquire.load(std::memory_order_relaxed);
+			report.m_nContended += stat.m_nContended.load(std::memory_order_relaxed);
+			report.m_nWaitNs += stat.m_nWaitNs.load(std::memory_order_relaxed);
+			report.m_nMaxWaitNs = MAX(report.m_nMaxWaitNs, stat.m_nMaxWaitNs.load(std::memory_order_relaxed));
+			report.m_nHoldNs += stat.m_nHoldNs.load(std::memory_order_relaxed);
+			report.m_nMaxHoldNs = MAX(report.m_nMaxHoldNs, stat.m_nMaxHoldNs.load(std::memory_order_relaxed));
+		}
+		if (report.m_nAcquire > 0)
+		{
+			rReport.push_back(report);
+		}
+	}
+	std::sort(rReport.begin(), rReport.end(), [](const CLockReport& a, const CLockReport& b)
+	{
+		return a.m_nWaitNs > b.m_nWaitNs;
+	});
+}
+
+void CLockProfile::LogReport()
+{
+	std::vector<CLockReport> report;
+	GetReport(report);
+	for (size_t index = 0; index < report.size(); index++)
+	{
+		CLockReport& item = report[index];
+		DISK_LOG(DEBUG_DISK, "lock profile {} acquire = {} contended = {} wait = {} us max wait = {} us hold = {} us max hold = {} us",
+			item.m_Name.c_str(), item.m_nAcquire, item.m_nContended, item.m_nWaitNs / 1000, item.m_nMaxWaitNs / 1000,
+			item.m_nHoldNs / 1000, item.m_nMaxHoldNs / 1000);
+	}
+}
+
+uint64 CLockProfiler::Now()
+{
+	return CTscClock::NowNs();
+}
+
+int CLockProfiler::GetId()
+{
+	int nId = m_nId.load(std::memory_order_relaxed);
+	if (nId < 0)
+	{
+		nId = CLockProfile::GetSingletonPtr()->GetNameId(m_pName);
+		m_nId.store(nId, std::memory_order_relaxed);
+	}
+	return nId;
+}
+
+void CLockProfiler::OnAcquire(bool bContended, uint64 nWaitNs, bool bShared)
+{
+	CLockThreadStats* pStats = CLockProfile::GetSingletonPtr()->GetThreadStats();
+	CLockStat& stat = pStats->m_Stats[GetId()];
+	AddStat(stat.m_nAcquire, 1);
+	if (bContended)
+	{
+		AddStat(stat.m_nContended, 1);
+		AddStat(stat.m_nWaitNs, nWaitNs);
+		MaxStat(stat.m_nMaxWaitNs, nWaitNs);
+	}
+	uint64 nNow = Now();
+	if (!bShared)
+	{
+		m_nHoldStart = nNow;
+	}
+	else if (pStats->m_nReadDepth < LOCK_PROFILE_READ_DEPTH)
+	{
+		pStats->m_ReadHolds[pStats->m_nReadDepth].m_pLock = this;
+		pStats->m_ReadHolds[pStats->m_nReadDepth].m_nStart = nNow;
+		pStats->m_nReadDepth++;
+	}
+}
+
+void CLockProfiler::OnRelease()
+{
+	CLockThreadStats* pStats = CLockProfile::GetSingletonPtr()->GetThreadStats();
+	uint64 nStart = 0;
+	for (int index = pStats->m_nReadDepth - 1; index >= 0; index--)
+	{
+		if (pStats->m_ReadHolds[index].m_pLock == this)
+		{
+			nStart = pStats->m_ReadHolds[index].m_nStart;
+			for (; index + 1 < pStats->m_nReadDepth; index++)
+			{
+				pStats->m_ReadHolds[index] = pStats->m_ReadHolds[index + 1];
+			}
+			pStats->m_nReadDepth--;
+			break;
+		}
+	}
+	if (nStart == 0)
+	{
+		//ʱڱ,еĿʼʱͷź,0Ͳͳ
+		nStart = m_nHoldStart;
+		if (nStart != 0)
+		{
+			m_nHoldStart = 0;
+		}
+	}
+	if (nStart == 0)
+	{
+		return;
+	}
+	uint64 nHold = Now() - nStart;
+	CLockStat& stat = pStats->m_Stats[GetId()];
+	AddStat(stat.m_nHoldNs, nHold);
+	MaxStat(stat.m_nMaxHoldNs, nHold);
+}
+#endif
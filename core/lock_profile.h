@@ -0,0 +1,153 @@
+/*****************************************************************
+* FileName:lock_profile.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __LOCK_PROFILE_H__
+#define __LOCK_PROFILE_H__
+
+#include "base.h"
+
+//ʱ-DLOCK_PROFILEͳ,ֻ֧Linux(Windowsmy_lock.hstd::mutex)
+//رʱĺȫչΪջԭļ,ﲻκγԱָ
+#if defined(LOCK_PROFILE) && defined(__LINUX__)
+#define LOCK_PROFILE_ON
+#endif
+
+#if defined(LOCK_PROFILE_ON)
+#include <vector>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include "singleton.h"
+
+//ֵָ,ͬһͳ,Ķǵһ
+#define LOCK_PROFILE_MAX_NAME		(256)
+//ÿ߳ͬʱеĶ,ĶͳƳʱ
+#define LOCK_PROFILE_READ_DEPTH		(16)
+
+//һ߳һϵͳ,ֻ߳д,ʱ̶߳
+struct CLockStat
+{
+	std::atomic<uint64>		m_nAcquire;
+	std::atomic<uint64>		m_nContended;
+	std::atomic<uint64>		m_nWaitNs;
+	std::atomic<uint64>		m_nMaxWaitNs;
+	std::atomic<uint64>		m_nHoldNs;
+	std::atomic<uint64>		m_nMaxHoldNs;
+};
+
+//̵߳ͳͰ,һμʱ,߳˳
+struct CLockThreadStats
+{
+	struct CReadHold
+	{
+		const void*		m_pLock;
+		uint64			m_nStart;
+	};
+	CLockStat		m_Stats[LOCK_PROFILE_MAX_NAME];
+	CReadHold		m_ReadHolds[LOCK_PROFILE_READ_DEPTH];		//ǰеĶͿʼʱ,ͬʱ,ܼ
+	int				m_nReadDepth;
+};
+
+//һ,̻߳
+struct CLockReport
+{
+	std::string		m_Name;
+	uint64			m_nAcquire;
+	uint64			m_nContended;
+	uint64			m_nWaitNs;
+	uint64			m_nMaxWaitNs;
+	uint64			m_nHoldNs;
+	uint64			m_nMaxHoldNs;
+};
+
+class CLockProfile : public CSingleton<CLockProfile>
+{
+public:
+	CLockProfile();
+	~CLockProfile();
+	//ֶӦı,һγʱ
+	int		GetNameId(const char* pName);
+	//ǰ̵߳ͳͰ
+	CLockThreadStats*	GetThreadStats();
+	//ܵȴʱӴСĻ
+	void	GetReport(std::vector<CLockReport>& rReport);
+	//־
+	void	LogReport();
+private:
+	std::mutex								m_Mutex;
+	std::unordered_map<std::string, int>	m_NameIds;
+	std::vector<std::string>				m_Names;
+	std::vector<CLockThreadStats*>			m_Threads;
+};
+
+/**
+ * ÿһ,ֺеĿʼʱ
+ * ǰһ,ʧһξ,ʧܵõʱȴʱ;ͷʱǳʱ
+ */
+class CLockProfiler
+{
+public:
+	explicit CLockProfiler(const char* pName) : m_pName(pName), m_nId(-1), m_nHoldStart(0) {}
+	//ֻûʹʱ
+	void	SetName(const char* pName)	{ m_pName = pName; m_nId.store(-1, std::memory_order_relaxed); }
+
+	template<typename TryFunc, typename LockFunc>
+	inline void	Acquire(TryFunc fTry, LockFunc fLock, bool bShared)
+	{
+		if (fTry())
+		{
+			OnAcquire(false, 0, bShared);
+			return;
+		}
+		uint64 nStart = Now();
+		fLock();
+		OnAcquire(true, Now() - nStart, bShared);
+	}
+
+	inline void	OnTryLock(bool bSuccess, bool bShared)
+	{
+		if (bSuccess)
+		{
+			OnAcquire(false, 0, bShared);
+		}
+	}
+	void	OnAcquire(bool bContended, uint64 nWaitNs, bool bShared);
+	//֮ǰ,ǰ̳߳жʱ,
+	void	OnRelease();
+private:
+	static uint64	Now();
+	int		GetId();
+private:
+	const char*			m_pName;
+	std::atomic_int		m_nId;
+	uint64				m_nHoldStart;		//ʱɳ߶д
+};
+
+//˽гԱ
+#define LOCK_PROFILE_MEMBER \
+	public: \
+		void SetProfileName(const char* pName)	{ m_Profiler.SetName(pName); } \
+	private: \
+		CLockProfiler	m_Profiler;
+//캯ʼбһ,ûʼʱLOCK_PROFILE_INIT_FIRST
+#define LOCK_PROFILE_INIT(pName)						, m_Profiler(pName)
+#define LOCK_PROFILE_INIT_FIRST(pName)					: m_Profiler(pName)
+#define LOCK_PROFILE_ACQUIRE(tryExpr, lockExpr, bShared)	m_Profiler.Acquire([&]() { return tryExpr; }, [&]() { lockExpr; }, bShared)
+#define LOCK_PROFILE_TRY(bSuccess, bShared)				m_Profiler.OnTryLock(bSuccess, bShared)
+#define LOCK_PROFILE_RELEASE()							m_Profiler.OnRelease()
+//е,Windows¿std::mutex,ֻ
+#define LOCK_PROFILE_NAME(lock, pName)					(lock).SetProfileName(pName)
+#else
+#define LOCK_PROFILE_MEMBER
+#define LOCK_PROFILE_INIT(pName)
+#define LOCK_PROFILE_INIT_FIRST(pName)
+#define LOCK_PROFILE_ACQUIRE(tryExpr, lockExpr, bShared)	lockExpr
+#define LOCK_PROFILE_TRY(bSuccess, bShared)
+#define LOCK_PROFILE_RELEASE()
+#define LOCK_PROFILE_NAME(lock, pName)
+#endif
+
+#endif //__LOCK_PROFILE_H__
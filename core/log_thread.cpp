@@ -0,0 +1,61 @@
+#include <thread>
+#include "log_thread.h"
+#include "log.h"
+
+CLogThread::CLogThread()
+	: m_bStarted(false)
+{
+	//֤CAsyncLog־̹߳,־߳
+	CAsyncLog::GetSingletonPtr();
+}
+
+CLogThread::~CLogThread()
+{
+	StopLog();
+}
+
+bool CLogThread::PrepareToRun()
+{
+	return true;
+}
+
+bool CLogThread::PrepareEnd()
+{
+	return true;
+}
+
+void CLogThread::Run()
+{
+	while (!IsStoped())
+	{
+		if (CAsyncLog::GetSingletonPtr()->Drain() == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(LOG_THREAD_IDLE_SLEEP));
+		}
+	}
+}
+
+void CLogThread::StartLog(enLogOverflowPolicy ePolicy)
+{
+	bool bExpected = false;
+	if (!m_bStarted.compare_exchange_strong(bExpected, true))
+	{
+		return;
+	}
+	CAsyncLog::GetSingletonPtr()->SetOverflowPolicy(ePolicy);
+	CAsyncLog::InstallCrashHandler();
+	CAsyncLog::GetSingletonPtr()->SetRunning(true);
+	CreateThread();
+}
+
+void CLogThread::StopLog()
+{
+	if (!m_bStarted.load() || IsStoped())
+	{
+		return;
+	}
+	Stop();
+	Join();
+	CAsyncLog::GetSingletonPtr()->SetRunning(false);
+	CAsyncLog::GetSingletonPtr()->Flush();
+}
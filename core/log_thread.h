@@ -0,0 +1,37 @@
+/*****************************************************************
+* FileName:log_thread.h
+* Summary :
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#ifndef __LOG_THREAD_H__
+#define __LOG_THREAD_H__
+
+#include "my_thread.h"
+#include "singleton.h"
+#include "async_log.h"
+
+//־߳̿ʱʱ()
+#define LOG_THREAD_IDLE_SLEEP	(1)
+
+/**
+ * ־̨߳,Ѹ̵߳־λдĿ,ֻһ
+ * ֮CACHE_LOG/DISK_LOGڵֻ߳Ʊ
+ */
+class CLogThread : public CMyThread, public CSingleton<CLogThread>
+{
+public:
+	CLogThread();
+	virtual ~CLogThread();
+	virtual bool PrepareToRun();
+	virtual bool PrepareEnd();
+	virtual void Run();
+	//־̲߳װʱˢ־Ĵ,εֻһ
+	void StartLog(enLogOverflowPolicy ePolicy = eLogOverflowBlock);
+	//ֹͣ־߳,ʣ־,ָ֮ͬ,ֹͣٴ
+	void StopLog();
+private:
+	std::atomic_bool	m_bStarted;
+};
+
+#endif //__LOG_THREAD_H__
@@ -8,14 +8,24 @@
 #define __MY_LOCK_H__
 
 #include "base.h"
+#include "lock_profile.h"
 #include <mutex>
+#if defined(__LINUX__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+//ӦòʱĴ,futex
+#define ADAPTIVE_LOCK_SPIN	(128)
 
 //
 #if defined(__LINUX__)
 class CMyLock
 {
 public:
-	CMyLock() 
+	//pNameֻڴLOCK_PROFILEʱʹ,ͬһͳ
+	CMyLock(const char* pName = "CMyLock")
+		LOCK_PROFILE_INIT_FIRST(pName)
 	{
 		pthread_mutex_init(&m_Mutex, NULL); 
 	}
@@ -27,15 +37,17 @@ public:
 
 	void	Lock() 
 	{
-		pthread_mutex_lock(&m_Mutex);
+		LOCK_PROFILE_ACQUIRE(pthread_mutex_trylock(&m_Mutex) == 0, pthread_mutex_lock(&m_Mutex), false);
 	}
 
 	void	Unlock()
 	{ 
+		LOCK_PROFILE_RELEASE();
 		pthread_mutex_unlock(&m_Mutex); 
 	}
 private:
 	pthread_mutex_t 	m_Mutex;
+	LOCK_PROFILE_MEMBER
 };
 
 //Զ
@@ -59,7 +71,8 @@ private:
 class CMyRWLock
 {
 public:
-	CMyRWLock()
+	CMyRWLock(const char* pName = "CMyRWLock")
+		LOCK_PROFILE_INIT_FIRST(pName)
 	{
 		pthread_rwlock_init(&m_Mutex, NULL);
 	}
@@ -71,20 +84,22 @@ public:
 
 	void	RLock()
 	{
-		pthread_rwlock_rdlock(&m_Mutex);
+		LOCK_PROFILE_ACQUIRE(pthread_rwlock_tryrdlock(&m_Mutex) == 0, pthread_rwlock_rdlock(&m_Mutex), true);
 	}
 
 	void	WLock()
 	{
-		pthread_rwlock_wrlock(&m_Mutex);
+		LOCK_PROFILE_ACQUIRE(pthread_rwlock_trywrlock(&m_Mutex) == 0, pthread_rwlock_wrlock(&m_Mutex), false);
 	}
 
 	void	Unlock()
 	{
+		LOCK_PROFILE_RELEASE();
 		pthread_rwlock_unlock(&m_Mutex);
 	}
 private:
 	pthread_rwlock_t  	m_Mutex;
+	LOCK_PROFILE_MEMBER
 };
 
 //Զ
@@ -122,11 +137,107 @@ public:
 private:
 	CMyRWLock* m_pLock;
 };
+
+/**
+ * Ӧ,ֻмʮĶٽ(е):pauseһС,òfutex
+ * m_nState: 0δ,1ûеȴ,2ҿеȴ
+ * ֻ״̬Ϊ2ʱŵfutex,޾ʱûϵͳ
+ */
+class CAdaptiveLock
+{
+public:
+	CAdaptiveLock(const char* pName = "CAdaptiveLock") : m_nState(0) LOCK_PROFILE_INIT(pName)
+	{
+		static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex needs a plain int");
+	}
+
+	void	Lock()
+	{
+		LOCK_PROFILE_ACQUIRE(TryLockRaw(), LockRaw(), false);
+	}
+
+	bool	TryLock()
+	{
+		bool bRet = TryLockRaw();
+		LOCK_PROFILE_TRY(bRet, false);
+		return bRet;
+	}
+
+	void	Unlock()
+	{
+		LOCK_PROFILE_RELEASE();
+		if (m_nState.exchange(0, std::memory_order_release) == 2)
+		{
+			syscall(SYS_futex, (int*)&m_nState, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		}
+	}
+private:
+	bool	TryLockRaw()
+	{
+		int nExpected = 0;
+		return m_nState.compare_exchange_strong(nExpected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void	LockRaw()
+	{
+		if (!TryLockRaw())
+		{
+			LockSlow();
+		}
+	}
+
+	void	LockSlow()
+	{
+		//ߺܿͻͷ,;Ѿеȴʱ˵ʱϳ,ֱ
+		for (int nSpin = 0; nSpin < ADAPTIVE_LOCK_SPIN; nSpin++)
+		{
+			int nState = m_nState.load(std::memory_order_relaxed);
+			if (nState == 0 && m_nState.compare_exchange_weak(nState, 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return;
+			}
+			if (nState == 2)
+			{
+				break;
+			}
+			CPU_PAUSE();
+		}
+		//ϵȴλ,2,߲֪Ƿȴ
+		while (m_nState.exchange(2, std::memory_order_acquire) != 0)
+		{
+			syscall(SYS_futex, (int*)&m_nState, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+		}
+	}
+private:
+	std::atomic<int>	m_nState;
+	LOCK_PROFILE_MEMBER
+};
+
+//Զ
+class CSafeAdaptiveLock
+{
+public:
+	CSafeAdaptiveLock() = delete;
+	CSafeAdaptiveLock(CAdaptiveLock& rLock)
+	{
+		m_pLock = &rLock;
+		m_pLock->Lock();
+	}
+	~CSafeAdaptiveLock()
+	{
+		m_pLock->Unlock();
+	}
+private:
+	CAdaptiveLock* m_pLock;
+};
 #else
 	#define CMyLock std::mutex 
 	#define CSafeLock std::lock_guard<std::mutex>
 	#define CSafeRLock std::lock_guard<std::mutex>
 	#define CSafeWLock std::lock_guard<std::mutex>
+	//Windowsstd::mutexSRWLOCK,
+	#define CAdaptiveLock std::mutex
+	#define CSafeAdaptiveLock std::lock_guard<std::mutex>
 #endif
 
 #endif //__MY_LOCK_H__
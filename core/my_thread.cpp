@@ -4,6 +4,7 @@
 #include "time_helper.h"
 
 thread_local thread_data g_thread_data;
+std::atomic_int g_nThreadIndexSeq(0);
 
 CMyThread::CMyThread()
 {
@@ -20,13 +20,14 @@ class CMyThread;
 class CTask;
 class CTaskScheduler;
 
+extern std::atomic_int g_nThreadIndexSeq;
+
 struct thread_data
 {
-	std::tm 						m_CacheTime;	
-	TimePoint						m_CacheTimePoint;
     TID                             m_OwnerThreadID;
+	int								m_nThreadIndex;		//ڴ0ʼ߳,ÿ̵߳ݲ
 	
-	thread_data() : m_OwnerThreadID(0) {}
+	thread_data() : m_OwnerThreadID(0), m_nThreadIndex(-1) {}
     TID getOwnerThreadID() 
     {
         if(m_OwnerThreadID == 0)
@@ -35,6 +36,14 @@ struct thread_data
         }
         return m_OwnerThreadID;
     }
+	int getThreadIndex()
+	{
+		if (m_nThreadIndex < 0)
+		{
+			m_nThreadIndex = g_nThreadIndexSeq.fetch_add(1, std::memory_order_relaxed);
+		}
+		return m_nThreadIndex;
+	}
 };
 
 typedef std::function<void(void*)> ThreadFuncParam;
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include "sharded_scheduler.h"
+
+//ȶ64λϣ(splitmix64ĻϺ),ڵidҲܾȷɢ
+static inline uint64 HashShardKey(uint64 nKey)
+{
+	nKey ^= nKey >> 30;
+	nKey *= 0xBF58476D1CE4E5B9ULL;
+	nKey ^= nKey >> 27;
+	nKey *= 0x94D049BB133111EBULL;
+	nKey ^= nKey >> 31;
+	return nKey;
+}
+
+CShardedScheduler::CShardedScheduler(std::string signature, CSafePtr<CThreadScheduler> pPool, int nShards)
+	: m_Signature(signature),
+	m_KeyLock("CShardedScheduler::m_KeyLock")
+{
+	nShards = MAX(nShards, 1);
+	for (int index = 0; index < nShards; index++)
+	{
+		m_Shards.push_back(new CStrandScheduler(signature, pPool));
+	}
+}
+
+CShardedScheduler::~CShardedScheduler()
+{
+	for (size_t index = 0; index < m_Shards.size(); index++)
+	{
+		m_Shards[index].Free();
+	}
+	m_Shards.clear();
+	for (auto it = m_Keys.begin(); it != m_Keys.end(); ++it)
+	{
+		SAFE_DELETE(it->second);
+	}
+	m_Keys.clear();
+}
+
+int CShardedScheduler::GetHomeShard(uint64 nKey)
+{
+	return (int)(HashShardKey(nKey) % m_Shards.size());
+}
+
+int CShardedScheduler::GetShard(uint64 nKey)
+{
+	CSafeBravoRLock guard(m_KeyLock);
+	auto it = m_Keys.find(nKey);
+	return it != m_Keys.end() ? it->second->m_nShard : GetHomeShard(nKey);
+}
+
+ShardTicketPtr CShardedScheduler::AcquireKey(uint64 nKey, int& nShard)
+{
+	CShardKey* pKey = NULL;
+	{
+		CSafeBravoRLock guard(m_KeyLock);
+		auto it = m_Keys.find(nKey);
+		if (it != m_Keys.end())
+		{
+			//жʱƽⲻ޸ķƬ,δ0֮Ҳ
+			pKey = it->second;
+			pKey->m_nPending.fetch_add(1, std::memory_order_relaxed);
+			nShard = pKey->m_nShard;
+		}
+	}
+	if (pKey == NULL)
+	{
+		CSafeBravoWLock guard(m_KeyLock);
+		auto it = m_Keys.find(nKey);
+		if (it != m_Keys.end())
+		{
+			pKey = it->second;
+		}
+		else
+		{
+			pKey = new CShardKey(GetHomeShard(nKey));
+			m_Keys[nKey] = pKey;
+		}
+		pKey->m_nPending.fetch_add(1, std::memory_order_relaxed);
+		nShard = pKey->m_nShard;
+	}
+	pKey->m_nCount.fetch_add(1, std::memory_order_relaxed);
+	return std::make_shared<CShardTicket>(pKey);
+}
+
+int CShardedScheduler::Rebalance(double fSkew)
+{
+	CSafeBravoWLock guard(m_KeyLock);
+	size_t nShards = m_Shards.size();
+	std::vector<uint64> loads(nShards, 0);
+	uint64 nTotal = 0;
+	for (auto it = m_Keys.begin(); it != m_Keys.end(); ++it)
+	{
+		uint64 nCount = it->second->m_nCount.load(std::memory_order_relaxed);
+		loads[it->second->m_nShard] += nCount;
+		nTotal += nCount;
+	}
+	int nMoved = 0;
+	double fAverage = (double)nTotal / nShards;
+	for (size_t nRound = 0; nTotal > 0 && nRound < nShards; nRound++)
+	{
+		int nHot = (int)(std::max_element(loads.begin(), loads.end()) - loads.begin());
+		int nCold = (int)(std::min_element(loads.begin(), loads.end()) - loads.begin());
+		if (loads[nHot] <= fAverage * fSkew || nHot == nCold)
+		{
+			break;
+		}
+		//æƬϵĿkey,Ų,ŲĴ
+		std::vector<std::pair<uint64, CShardKey*>> candidates;
+		for (auto it = m_Keys.begin(); it != m_Keys.end(); ++it)
+		{
+			CShardKey* pKey = it->second;
+			//acquire:ʱrelease,Ų֮·ƬϵܿɷƬ޸
+			if (pKey->m_nShard == nHot && pKey->m_nPending.load(std::memory_order_acquire) == 0
+				&& pKey->m_nCount.load(std::memory_order_relaxed) > 0)
+			{
+				candidates.push_back(std::make_pair(pKey->m_nCount.load(std::memory_order_relaxed), pKey));
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const std::pair<uint64, CShardKey*>& a, const std::pair<uint64, CShardKey*>& b)
+		{
+			return a.first > b.first;
+		});
+		int nRoundMoved = 0;
+		for (size_t index = 0; index < candidates.size() && loads[nHot] > fAverage; index++)
+		{
+			uint64 nCount = candidates[index].first;
+			if (loads[nCold] + nCount > fAverage)
+			{
+				continue;
+			}
+			candidates[index].second->m_nShard = nCold;
+			loads[nHot] -= nCount;
+			loads[nCold] += nCount;
+			nRoundMoved++;
+		}
+		if (nRoundMoved == 0)
+		{
+			break;
+		}
+		nMoved += nRoundMoved;
+	}
+	for (auto it = m_Keys.begin(); it != m_Keys.end();)
+	{
+		CShardKey* pKey = it->second;
+		pKey->m_nCount.store(0, std::memory_order_relaxed);
+		if (pKey->m_nPending.load(std::memory_order_acquire) == 0 && pKey->m_nShard == GetHomeShard(it->first))
+		{
+			SAFE_DELETE(pKey);
+			it = m_Keys.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return nMoved;
+}
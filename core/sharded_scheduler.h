@@ -0,0 +1,190 @@
+/**
+ * @file sharded_scheduler.h
+ * @author DGuco(1139140929@qq.com)
+ * @brief keyƬĵ,ͬһkeyִ
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#ifndef __SHARDED_SCHEDULER_H__
+#define __SHARDED_SCHEDULER_H__
+
+#include <unordered_map>
+#include "strand_scheduler.h"
+
+//ĬϷƬ
+#define SHARDED_DEFAULT_SHARDS	(64)
+//æƬĸسƽصô౶ʱƽ
+#define SHARDED_SKEW_RATIO		(2.0)
+
+//һkey·Ϣ,Ƭֻƽʱûδ޸
+struct CShardKey
+{
+	CShardKey(int nShard) : m_nShard(nShard), m_nPending(0), m_nCount(0) {}
+	int						m_nShard;		//·ɱ,дд
+	std::atomic_int			m_nPending;		//ѾͶݻûִ(ͷ)
+	std::atomic<uint64>		m_nCount;		//ϴƽͶݵ
+};
+
+//ĺ,ִϹ黹(CSafeShardTicket);ûִ(ȡܾǰʧ)ʱ溯ͷŹ黹
+//黹ʱkeyδһ,÷ҲӰ
+struct CShardTicket
+{
+	CShardTicket(CShardKey* pKey) : m_pKey(pKey) {}
+	~CShardTicket()		{ m_pKey->m_nPending.fetch_sub(1, std::memory_order_release); }
+	CShardKey*			m_pKey;
+};
+typedef std::shared_ptr<CShardTicket> ShardTicketPtr;
+
+//ػ׳쳣ʱ黹Ʊ,
+struct CSafeShardTicket
+{
+	CSafeShardTicket(ShardTicketPtr& pTicket) : m_pTicket(pTicket) {}
+	~CSafeShardTicket()	{ m_pTicket.reset(); }
+	ShardTicketPtr&		m_pTicket;
+};
+
+class CShardedScheduler;
+
+//CShardedScheduler::Scheduleķֵ,Ҳ԰keyͶ
+template<typename Res>
+class CShardedTaskHelper
+{
+public:
+	using ReturnType = Res;
+public:
+	CShardedTaskHelper(CSafePtr<CShardedScheduler> pScheduler, CTaskHelper<Res> helper)
+		: m_pScheduler(pScheduler), m_Helper(helper)
+	{}
+
+	template<class Func, typename return_type = typename std::result_of<Func(Res)>::type>
+	CShardedTaskHelper<return_type> ThenAccept(uint64 nKey, Func&& func);
+
+	CTaskHelper<Res> GetHelper()	{ return m_Helper; }
+	TaskPtr GetTask()				{ return m_Helper.GetTask(); }
+private:
+	CSafePtr<CShardedScheduler>	m_pScheduler;
+	CTaskHelper<Res>			m_Helper;
+};
+
+template<>
+class CShardedTaskHelper<void>
+{
+public:
+	using ReturnType = void;
+public:
+	CShardedTaskHelper(CSafePtr<CShardedScheduler> pScheduler, CTaskHelper<void> helper)
+		: m_pScheduler(pScheduler), m_Helper(helper)
+	{}
+
+	template<class Func, typename return_type = typename std::result_of<Func()>::type>
+	CShardedTaskHelper<return_type> ThenApply(uint64 nKey, Func&& func);
+
+	CTaskHelper<void> GetHelper()	{ return m_Helper; }
+	TaskPtr GetTask()				{ return m_Helper.GetTask(); }
+private:
+	CSafePtr<CShardedScheduler>	m_pScheduler;
+	CTaskHelper<void>			m_Helper;
+};
+
+/**
+ * keyƬĵ:key(ҡid)ȶĹϣѡһƬ,ÿƬ̳߳ϵһstrand,
+ * ͬһkeyͬһƬϰͶ˳ִ,Ҫ;ͬƬɢ̳߳صй߳
+ * Rebalanceѡ:ƬбʱûδkeyæķƬŲеķƬ,ŲǰͬһkeyȻ
+ * ֹֻ̳֮߳ͣͷ
+ */
+class CShardedScheduler
+{
+public:
+	CShardedScheduler(std::string signature, CSafePtr<CThreadScheduler> pPool, int nShards = SHARDED_DEFAULT_SHARDS);
+	~CShardedScheduler();
+	//m_KeyLockажĳԱ
+	CACHE_LINE_NEW_DELETE
+
+	template<class Func, typename return_type = typename std::result_of<Func()>::type>
+	CShardedTaskHelper<return_type> Schedule(uint64 nKey, Func&& f)
+	{
+		return Schedule(nKey, m_Signature, std::forward<Func>(f));
+	}
+
+	template<class Func, typename return_type = typename std::result_of<Func()>::type>
+	CShardedTaskHelper<return_type> Schedule(uint64 nKey, std::string signature, Func&& f)
+	{
+		int nShard = 0;
+		ShardTicketPtr pTicket = AcquireKey(nKey, nShard);
+		std::function<return_type()> func = std::forward<Func>(f);
+		CTaskHelper<return_type> helper = m_Shards[nShard]->Schedule(signature,
+			[pTicket, func]() mutable
+			{
+				CSafeShardTicket guard(pTicket);
+				return func();
+			});
+		return CShardedTaskHelper<return_type>(this, helper);
+	}
+
+	//parentɺѽf,fnKeyķƬִ
+	template<typename Res, class Func, typename return_type = typename std::result_of<Func(Res)>::type>
+	CShardedTaskHelper<return_type> ThenAccept(CTaskHelper<Res> parent, uint64 nKey, Func&& f)
+	{
+		int nShard = 0;
+		ShardTicketPtr pTicket = AcquireKey(nKey, nShard);
+		std::function<return_type(Res)> func = std::forward<Func>(f);
+		CTaskHelper<return_type> helper = parent.ThenAccept(m_Shards[nShard],
+			[pTicket, func](Res res) mutable
+			{
+				CSafeShardTicket guard(pTicket);
+				return func(res);
+			});
+		return CShardedTaskHelper<return_type>(this, helper);
+	}
+
+	template<class Func, typename return_type = typename std::result_of<Func()>::type>
+	CShardedTaskHelper<return_type> ThenApply(CTaskHelper<void> parent, uint64 nKey, Func&& f)
+	{
+		int nShard = 0;
+		ShardTicketPtr pTicket = AcquireKey(nKey, nShard);
+		std::function<return_type()> func = std::forward<Func>(f);
+		CTaskHelper<return_type> helper = parent.ThenApply(m_Shards[nShard],
+			[pTicket, func]() mutable
+			{
+				CSafeShardTicket guard(pTicket);
+				return func();
+			});
+		return CShardedTaskHelper<return_type>(this, helper);
+	}
+
+	//keyǰڵķƬ
+	int		GetShard(uint64 nKey);
+	//keyûбŲʱڵķƬ
+	int		GetHomeShard(uint64 nKey);
+	int		ShardCount()	{ return (int)m_Shards.size(); }
+	/**
+	 * æƬĸ(ϴƽͶݵ)ƽصfSkewʱ,
+	 * æƬûδkeyӶൽŲеķƬ,ŲƽΪֹ
+	 * ֮ռ,ͷſеġԭʼƬϵkey;Ųkey
+	 */
+	int		Rebalance(double fSkew = SHARDED_SKEW_RATIO);
+private:
+	//ҵߴkey,δһ,صƱݸ
+	ShardTicketPtr	AcquireKey(uint64 nKey, int& nShard);
+private:
+	std::string								m_Signature;
+	std::vector<CSafePtr<CStrandScheduler>>	m_Shards;
+	std::unordered_map<uint64, CShardKey*>	m_Keys;
+	CBravoRWLock							m_KeyLock;		//д:ֻkeyƽʱд
+};
+
+template<typename Res>
+template<class Func, typename return_type>
+CShardedTaskHelper<return_type> CShardedTaskHelper<Res>::ThenAccept(uint64 nKey, Func&& func)
+{
+	return m_pScheduler->ThenAccept(m_Helper, nKey, std::forward<Func>(func));
+}
+
+template<class Func, typename return_type>
+CShardedTaskHelper<return_type> CShardedTaskHelper<void>::ThenApply(uint64 nKey, Func&& func)
+{
+	return m_pScheduler->ThenApply(m_Helper, nKey, std::forward<Func>(func));
+}
+
+#endif //__SHARDED_SCHEDULER_H__
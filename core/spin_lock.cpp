@@ -0,0 +1,46 @@
+#include "spin_lock.h"
+#include "time_helper.h"
+
+static CBravoSlot g_BravoTable[BRAVO_TABLE_SIZE];
+static std::atomic_uint g_nBravoThreadSeq(0);
+//ÿ̵߳һõʱ,0ʾûз
+static thread_local uint32 g_nBravoThreadHash = 0;
+
+CBravoSlot* CBravoRWLock::GetSlot()
+{
+	uint32 nThreadHash = g_nBravoThreadHash;
+	if (nThreadHash == 0)
+	{
+		//߳ų˻ƽָ,߳ɢ
+		nThreadHash = (g_nBravoThreadSeq.fetch_add(1, std::memory_order_relaxed) + 1) * 0x9E3779B1u;
+		g_nBravoThreadHash = nThreadHash;
+	}
+	uint64 nLockHash = (uint64)(uintptr_t)this * 0x9E3779B97F4A7C15ULL;
+	return &g_BravoTable[(nThreadHash ^ (uint32)(nLockHash >> 32)) & (BRAVO_TABLE_SIZE - 1)];
+}
+
+void CBravoRWLock::RLockSlow()
+{
+	m_Lock.RLock();
+	//жʱд߽,ʱ´򿪶ƫ
+	if (!m_bReadBias.load(std::memory_order_relaxed) && CTscClock::NowNs() >= m_nInhibitUntil)
+	{
+		m_bReadBias.store(true, std::memory_order_release);
+	}
+}
+
+void CBravoRWLock::Revoke()
+{
+	m_bReadBias.store(false, std::memory_order_seq_cst);
+	uint64 nStart = CTscClock::NowNs();
+	for (int index = 0; index < BRAVO_TABLE_SIZE; index++)
+	{
+		CSpinBackoff backoff;
+		while (g_BravoTable[index].m_pLock.load(std::memory_order_seq_cst) == this)
+		{
+			backoff.Pause();
+		}
+	}
+	uint64 nNow = CTscClock::NowNs();
+	m_nInhibitUntil = nNow + (nNow - nStart) * BRAVO_INHIBIT_MULT;
+}
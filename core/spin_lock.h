@@ -2,31 +2,48 @@
 #define SPIN_LOCK_H
 
 #include <atomic>
+#include <thread>
 #include "base.h"
+#include "lock_profile.h"
 
 class CSpinLock
 {
 public:
-	CSpinLock() : flag{ false }
+	//pNameֻڴLOCK_PROFILEʱʹ,ͬһͳ
+	CSpinLock(const char* pName = "CSpinLock") : flag{ false } LOCK_PROFILE_INIT(pName)
 	{
 	}
 
 	inline void Lock()
 	{
-		while (flag.test_and_set(std::memory_order_acquire));
+		LOCK_PROFILE_ACQUIRE(TryLockRaw(), LockRaw(), false);
 	}
 
 	inline bool TryLock()
 	{
-		return !flag.test_and_set(std::memory_order_acquire);
+		bool bRet = TryLockRaw();
+		LOCK_PROFILE_TRY(bRet, false);
+		return bRet;
 	}
 
 	inline void UnLock()
 	{
+		LOCK_PROFILE_RELEASE();
 		flag.clear(std::memory_order_release);
 	}
+private:
+	inline bool TryLockRaw()
+	{
+		return !flag.test_and_set(std::memory_order_acquire);
+	}
+
+	inline void LockRaw()
+	{
+		while (flag.test_and_set(std::memory_order_acquire));
+	}
 private:
 	std::atomic_flag flag;
+	LOCK_PROFILE_MEMBER
 };
 
 //Զ
@@ -48,12 +65,241 @@ private:
 	CSpinLock* m_pLock;
 };
 
+//˱ʱpauseĳʼֵ
+#define SPIN_BACKOFF_MIN		(4)
+#define SPIN_BACKOFF_MAX		(1024)
+//ŶǰŶӵȴ,ÿ˵ȴpause,ָٰ֮˱
+#define TICKET_BACKOFF_UNIT		(32)
+
+//ָ˱:ÿεȴpause,޺ΪóCPU,߳ʱǰĵȴ߲л
+class CSpinBackoff
+{
+public:
+	CSpinBackoff() : m_nSpin(SPIN_BACKOFF_MIN) {}
+
+	inline void Pause()
+	{
+		if (m_nSpin >= SPIN_BACKOFF_MAX)
+		{
+			std::this_thread::yield();
+			return;
+		}
+		for (uint32 i = 0; i < m_nSpin; i++)
+		{
+			CPU_PAUSE();
+		}
+		m_nSpin *= 2;
+	}
+private:
+	uint32	m_nSpin;
+};
+
+/**
+ * Ŷ:ȡ˳ȵ,
+ * ȴʱǰ滹м˳ɱ˱,ٶm_nServingڻе;ȡźͽкŸռһ
+ * ȵõ߳ʱ,һ߿û,ȴ˻óCPU
+ */
+class CTicketLock
+{
+public:
+	CTicketLock(const char* pName = "CTicketLock") : m_nNext(0), m_nServing(0) LOCK_PROFILE_INIT(pName) {}
+
+	inline void Lock()
+	{
+		LOCK_PROFILE_ACQUIRE(TryLockRaw(), LockRaw(), false);
+	}
+
+	inline bool TryLock()
+	{
+		bool bRet = TryLockRaw();
+		LOCK_PROFILE_TRY(bRet, false);
+		return bRet;
+	}
+
+	inline void UnLock()
+	{
+		LOCK_PROFILE_RELEASE();
+		//ֻг߻޸m_nServing
+		m_nServing.store(m_nServing.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+private:
+	inline void LockRaw()
+	{
+		uint32 nTicket = m_nNext.fetch_add(1, std::memory_order_relaxed);
+		CSpinBackoff backoff;
+		while (true)
+		{
+			uint32 nServing = m_nServing.load(std::memory_order_acquire);
+			if (nServing == nTicket)
+			{
+				return;
+			}
+			for (uint32 i = (nTicket - nServing) * TICKET_BACKOFF_UNIT; i > 0; i--)
+			{
+				CPU_PAUSE();
+			}
+			backoff.Pause();
+		}
+	}
+
+	inline bool TryLockRaw()
+	{
+		uint32 nServing = m_nServing.load(std::memory_order_acquire);
+		uint32 nExpected = nServing;
+		return m_nNext.compare_exchange_strong(nExpected, nServing + 1, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+private:
+	CACHE_LINE_ALIGN std::atomic<uint32>	m_nNext;
+	CACHE_LINE_ALIGN std::atomic<uint32>	m_nServing;
+	LOCK_PROFILE_MEMBER
+};
+
+//Զ
+class CSafeTicketLock
+{
+public:
+	CSafeTicketLock() = delete;
+	CSafeTicketLock(CTicketLock& rLock)
+	{
+		m_pLock = &rLock;
+		m_pLock->Lock();
+	}
+
+	~CSafeTicketLock()
+	{
+		m_pLock->UnLock();
+	}
+private:
+	CTicketLock* m_pLock;
+};
+
+//MCSŶӽڵ,ɼһṩ(һջ),֮ǰͷ
+struct CACHE_LINE_ALIGN CMcsNode
+{
+	std::atomic<CMcsNode*>	m_pNext;
+	std::atomic_bool		m_bWaiting;
+};
+
+/**
+ * MCS:ȴų,ÿȴֻԼĽڵ,ʱֱӽһ,ȵ
+ * ʱֻһexchange,̶߳ʱ²½
+ */
+class CMcsLock
+{
+public:
+	CMcsLock() : m_pTail(NULL) {}
+
+	inline void Lock(CMcsNode& node)
+	{
+		node.m_pNext.store(NULL, std::memory_order_relaxed);
+		node.m_bWaiting.store(true, std::memory_order_relaxed);
+		CMcsNode* pPrev = m_pTail.exchange(&node, std::memory_order_acq_rel);
+		if (pPrev == NULL)
+		{
+			return;
+		}
+		pPrev->m_pNext.store(&node, std::memory_order_release);
+		CSpinBackoff backoff;
+		while (node.m_bWaiting.load(std::memory_order_acquire))
+		{
+			backoff.Pause();
+		}
+	}
+
+	inline bool TryLock(CMcsNode& node)
+	{
+		node.m_pNext.store(NULL, std::memory_order_relaxed);
+		node.m_bWaiting.store(false, std::memory_order_relaxed);
+		CMcsNode* pExpected = NULL;
+		return m_pTail.compare_exchange_strong(pExpected, &node, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	inline void UnLock(CMcsNode& node)
+	{
+		CMcsNode* pNext = node.m_pNext.load(std::memory_order_acquire);
+		if (pNext == NULL)
+		{
+			//ûк̾ͰѶβÿ;ʧ˵̸϶,Լ
+			CMcsNode* pExpected = &node;
+			if (m_pTail.compare_exchange_strong(pExpected, NULL, std::memory_order_release, std::memory_order_relaxed))
+			{
+				return;
+			}
+			while ((pNext = node.m_pNext.load(std::memory_order_acquire)) == NULL)
+			{
+				CPU_PAUSE();
+			}
+		}
+		pNext->m_bWaiting.store(false, std::memory_order_release);
+	}
+private:
+	CACHE_LINE_ALIGN std::atomic<CMcsNode*>	m_pTail;
+};
+
+//Զ,ŶӽڵԼĳԱ
+class CSafeMcsLock
+{
+public:
+	CSafeMcsLock() = delete;
+	CSafeMcsLock(CMcsLock& rLock)
+	{
+		m_pLock = &rLock;
+		m_pLock->Lock(m_Node);
+	}
+
+	~CSafeMcsLock()
+	{
+		m_pLock->UnLock(m_Node);
+	}
+private:
+	CMcsNode	m_Node;
+	CMcsLock*	m_pLock;
+};
+
 class CSpinRWLock
 {
 public:
-    CSpinRWLock() : state(0) {}
+    CSpinRWLock(const char* pName = "CSpinRWLock") : state(0) LOCK_PROFILE_INIT(pName) {}
 
     inline void RLock()
+    {
+        LOCK_PROFILE_ACQUIRE(TryRLockRaw(), RLockRaw(), true);
+    }
+
+    inline void WLock()
+    {
+        LOCK_PROFILE_ACQUIRE(TryWLockRaw(), WLockRaw(), false);
+    }
+
+    inline void UnlockR()
+    {
+        LOCK_PROFILE_RELEASE();
+        state.fetch_sub(1, std::memory_order_release);
+    }
+
+    inline void UnlockW()
+    {
+        LOCK_PROFILE_RELEASE();
+        state.store(0, std::memory_order_release);
+    }
+
+private:
+    //ûдʱһӶ
+    inline bool TryRLockRaw()
+    {
+        uint32_t expected = state.load(std::memory_order_relaxed);
+        return !(expected & 0x80000000) &&
+            state.compare_exchange_strong(expected, expected + 1, std::memory_order_acquire);
+    }
+
+    //ûκζдʱһд־λ
+    inline bool TryWLockRaw()
+    {
+        uint32_t expected = 0;
+        return state.compare_exchange_strong(expected, 0x80000000, std::memory_order_acquire);
+    }
+
+    inline void RLockRaw()
     {
         uint32_t expected;
         do {
@@ -65,7 +311,7 @@ public:
                                            std::memory_order_acquire));
     }
 
-    inline void WLock()
+    inline void WLockRaw()
     {
         //ʵ1 ȴûκζдڲд־λ
         /*
@@ -92,19 +338,10 @@ public:
         while ((state.load(std::memory_order_acquire) & 0x7FFFFFFF) != 0);
     }
 
-    inline void UnlockR()
-    {
-        state.fetch_sub(1, std::memory_order_release);
-    }
-
-    inline void UnlockW()
-    {
-        state.store(0, std::memory_order_release);
-    }
-
 private:
     CACHE_LINE_ALIGN size_t _;  // 仺Уα,splitlock
     std::atomic<uint32_t> state; // λʾд31λʾ
+    LOCK_PROFILE_MEMBER
 };
 
 //Զ
@@ -143,4 +380,120 @@ public:
 private:
     CSpinRWLock* m_pLock;
 };
+//BRAVOдȫֶ߱Ĳ,2
+#define BRAVO_TABLE_SIZE		(1024)
+//ƫ֮,ڳʱô౶ʱڲٴ򿪶ƫ
+#define BRAVO_INHIBIT_MULT		(9)
+
+class CBravoRWLock;
+
+//߱һ,ռһ,¼ռĶ߳еİ
+struct CACHE_LINE_ALIGN CBravoSlot
+{
+	std::atomic<CBravoRWLock*>	m_pLock;
+};
+
+/**
+ * BRAVOд:ƫʱ,߰(߳,)ϣȫֶ߱һ,CASռס۾õ,
+ * ̵ͬ߳ĶдǲͬĻ,Ŀ;۳ͻ߶ƫرʱ˻صCSpinRWLockĶ
+ * дCSpinRWLockд,ƫʱرɨű,ȱĶ߶뿪;
+ * ɨʱBRAVO_INHIBIT_MULTʱڲٴ򿪶ƫ,дʱ˻ͨд
+ */
+class CBravoRWLock
+{
+public:
+	//LOCK_PROFILEʱͳƵ˻ضĶߺд
+	CBravoRWLock(const char* pName = "CBravoRWLock") : m_bReadBias(true), m_nInhibitUntil(0), m_Lock(pName) {}
+
+	//ռõĲ,߶ʱNULL,ʱԭ
+	inline CBravoSlot* RLock()
+	{
+		if (m_bReadBias.load(std::memory_order_acquire))
+		{
+			CBravoSlot* pSlot = GetSlot();
+			CBravoRWLock* pExpected = NULL;
+			if (pSlot->m_pLock.compare_exchange_strong(pExpected, this, std::memory_order_seq_cst))
+			{
+				//ռ֮ȷһ,д߹رնƫ֮ɨ
+				if (m_bReadBias.load(std::memory_order_seq_cst))
+				{
+					return pSlot;
+				}
+				pSlot->m_pLock.store(NULL, std::memory_order_release);
+			}
+		}
+		RLockSlow();
+		return NULL;
+	}
+
+	inline void UnlockR(CBravoSlot* pSlot)
+	{
+		if (pSlot != NULL)
+		{
+			pSlot->m_pLock.store(NULL, std::memory_order_release);
+			return;
+		}
+		m_Lock.UnlockR();
+	}
+
+	inline void WLock()
+	{
+		m_Lock.WLock();
+		if (m_bReadBias.load(std::memory_order_relaxed))
+		{
+			Revoke();
+		}
+	}
+
+	inline void UnlockW()
+	{
+		m_Lock.UnlockW();
+	}
+private:
+	CBravoSlot*	GetSlot();
+	void		RLockSlow();
+	//رնƫ򲢵ȴĶ뿪,дʱ
+	void		Revoke();
+private:
+	std::atomic_bool	m_bReadBias;
+	uint64				m_nInhibitUntil;		//CTscClock,дʱд,жʱ
+	CSpinRWLock			m_Lock;
+};
+
+//Զ
+class CSafeBravoRLock
+{
+public:
+	CSafeBravoRLock() = delete;
+	CSafeBravoRLock(CBravoRWLock& rLock)
+	{
+		m_pLock = &rLock;
+		m_pSlot = m_pLock->RLock();
+	}
+	~CSafeBravoRLock()
+	{
+		m_pLock->UnlockR(m_pSlot);
+	}
+private:
+	CBravoRWLock*	m_pLock;
+	CBravoSlot*		m_pSlot;
+};
+
+//Զ
+class CSafeBravoWLock
+{
+public:
+	CSafeBravoWLock() = delete;
+	CSafeBravoWLock(CBravoRWLock& rLock)
+	{
+		m_pLock = &rLock;
+		m_pLock->WLock();
+	}
+	~CSafeBravoWLock()
+	{
+		m_pLock->UnlockW();
+	}
+private:
+	CBravoRWLock*	m_pLock;
+};
 #endif
\ No newline at end of file
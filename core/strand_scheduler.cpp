@@ -0,0 +1,93 @@
+#include "strand_scheduler.h"
+
+CStrandScheduler::CStrandScheduler(std::string signature, CSafePtr<CThreadScheduler> pPool, int nBatch)
+	: CTaskScheduler(signature),
+	m_pPool(pPool),
+	m_nBatch(MAX(nBatch, 1)),
+	m_bScheduled(false)
+{
+}
+
+CStrandScheduler::~CStrandScheduler()
+{
+}
+
+void CStrandScheduler::PushTask(TaskPtr pTask)
+{
+	pTask->SetEnqueueTime(CTscClock::NowNs());
+	bool bPost = false;
+	{
+		CSafeAdaptiveLock guard(m_queue_mutex);
+		m_Tasks.push(pTask);
+		//Ŷӻִʱ,ɵǰһȡ
+		if (!m_bScheduled)
+		{
+			m_bScheduled = true;
+			bPost = true;
+		}
+	}
+	if (bPost)
+	{
+		PostToPool();
+	}
+}
+
+void CStrandScheduler::ScheduleTaskAfter(TaskPtr pTask, time_t delay)
+{
+	CSafePtr<CTaskScheduler> pStrand = this;
+	TaskPtr pTimerTask = TaskCreater<void, void, std::function<void()>>::CreateTask(m_pPool.Get(), m_Signature + "_Delay",
+		[pStrand, pTask]()
+		{
+			//ǰȡScheduleTaskֱӶ
+			pStrand->ScheduleTask(pTask);
+		});
+	//ת̳߳ؾܾĻ,ʱԶͶݻ
+	pTimerTask->SetUnbounded(true);
+	m_pPool->ScheduleTaskAfter(pTimerTask, delay);
+}
+
+bool CStrandScheduler::IsScheduled()
+{
+	CSafeAdaptiveLock guard(m_queue_mutex);
+	return m_bScheduled;
+}
+
+void CStrandScheduler::RunBatch()
+{
+	for (int nCount = 0; nCount < m_nBatch; nCount++)
+	{
+		TaskPtr pTask;
+		{
+			CSafeAdaptiveLock guard(m_queue_mutex);
+			if (m_Tasks.empty())
+			{
+				m_bScheduled = false;
+				return;
+			}
+			pTask = m_Tasks.front();
+			m_Tasks.pop();
+		}
+		pTask->Run();
+	}
+	{
+		CSafeAdaptiveLock guard(m_queue_mutex);
+		if (m_Tasks.empty())
+		{
+			m_bScheduled = false;
+			return;
+		}
+	}
+	//һ˻,ŵ̳߳ضβ,ͬһ̳߳ϵstrandִ
+	PostToPool();
+}
+
+void CStrandScheduler::PostToPool()
+{
+	CSafePtr<CStrandScheduler> pStrand = this;
+	//̳߳:ܾĻm_bScheduledһֱΪtrue,strandҲᱻͶ
+	m_pPool->ScheduleUnbounded(m_Signature,
+		[pStrand]()
+		{
+			pStrand->RunBatch();
+		});
+}
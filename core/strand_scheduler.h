@@ -0,0 +1,45 @@
+/**
+ * @file strand_scheduler.h
+ * @author DGuco(1139140929@qq.com)
+ * @brief ,strandһ̳߳
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#ifndef __STRAND_SCHEDULER_H__
+#define __STRAND_SCHEDULER_H__
+
+#include "thread_scheduler.h"
+
+//strandһִе,ִ껹ŵ̳߳ضβ
+#define STRAND_BATCH_SIZE	(64)
+
+/**
+ * (strand):ԼͶ˳ִ,ͬһʱֻһִ߳,ռ߳,
+ * strandһCThreadSchedulerĹ̡߳ɿձΪǿʱŰԼͶݵ̳߳,
+ * ÿִnBatch,ʣŶ,ռ߳
+ * ǧĳһstrand,ֻ߳ȡ̳߳صĴС
+ * ֹֻ̳֮߳ͣstrandûʱͷ
+ */
+class CStrandScheduler : public CTaskScheduler
+{
+public:
+	CStrandScheduler(std::string signature, CSafePtr<CThreadScheduler> pPool, int nBatch = STRAND_BATCH_SIZE);
+	virtual ~CStrandScheduler();
+	//,strandʱͶݵ̳߳
+	virtual void PushTask(TaskPtr pTask);
+	//strandû߳ʱ,̳߳صʱ,ںͶݻԼ
+	virtual void ScheduleTaskAfter(TaskPtr pTask, time_t delay);
+	//Ƿ̳߳ضִ
+	bool IsScheduled();
+private:
+	//̳߳صĹִ߳һ
+	void RunBatch();
+	void PostToPool();
+private:
+	CSafePtr<CThreadScheduler>	m_pPool;
+	int							m_nBatch;
+	bool						m_bScheduled;	//m_queue_mutexʱд
+};
+
+#endif //__STRAND_SCHEDULER_H__
@@ -2,37 +2,60 @@
 #include "thread_scheduler.h"
 
 CTask::CTask(CSafePtr<CTaskScheduler> scheduler, std::string signature)
-	:m_pScheduler(scheduler),
-	m_TaskSignature(signature)
+	:m_pScheduler(scheduler.Get()),
+	m_pChildHead(NULL),
+	m_pColdInfo(new CTaskColdInfo(std::move(signature)))
 {
 	SetState(enTaskState::eTaskInit);
-	m_pArgsTypeList = NULL;
 };
 
 CTask::~CTask()
 {
 	try 
 	{
-		enTaskState bState = GetState();
-		if(bState == enTaskState::eTaskDone || bState == enTaskState::eTaskFailed)
+		if(IsFinished())
 		{
 			RunChildTask();
 		}
-		m_pArgsTypeList.Free();
 	}
 	catch(std::exception e)
 	{
-		if (m_pArgsTypeList != NULL)
-		{
-			m_pArgsTypeList.Free();
-		}
 	}
+	//ûִй,ͷŻŵڵ
+	CChildTaskNode* pNode = m_pChildHead.exchange(NULL, std::memory_order_acquire);
+	while (pNode != NULL)
+	{
+		CChildTaskNode* pNext = pNode->m_pNext;
+		delete pNode;
+		pNode = pNext;
+	}
+	SAFE_DELETE(m_pColdInfo);
 }
 
 void CTask::AddChildTask(TaskPtr pTask)
 {
-	CSafeLock guard(m_childTaskLock);
-	m_childTaskQueue.push(pTask);
+	CChildTaskNode* pNode = new CChildTaskNode();
+	pNode->m_pTask = std::move(pTask);
+	PushChildNode(pNode);
+}
+
+void CTask::SetCombineSlot(void* pSlot)
+{
+	if (m_pColdInfo->m_pCombineSlot != NULL)
+	{
+		ASSERT_EX(false, "This Task has combined once");
+	}
+	m_pColdInfo->m_pCombineSlot = pSlot;
+}
+
+void CTask::PushChildNode(CChildTaskNode* pNode)
+{
+	//acq_rel:RunChildTaskexchange,ҪôRunChildTaskժڵ,
+	//Ҫôժֵ֮,Ӷܿժ֮ǰõ״̬,÷IsFinished֮ٴִм
+	pNode->m_pNext = m_pChildHead.load(std::memory_order_relaxed);
+	while (!m_pChildHead.compare_exchange_weak(pNode->m_pNext, pNode, std::memory_order_acq_rel, std::memory_order_relaxed))
+	{
+	}
 }
 
 void CTask::OnFinish()
@@ -43,67 +66,130 @@ void CTask::OnFinish()
 
 void CTask::OnFailed() 
 {
+	//ѾȡѾ
+	if (GetState() == enTaskState::eTaskCancelled)
+	{
+		return;
+	}
 	SetState(enTaskState::eTaskFailed);
+	//ʧܵ񲻻ִ,еԴ(ƬƱ)ͷ
+	ReleaseResource();
 	RunChildTask();
-	CACHE_LOG(THREAD_ERROR, "Task[{}] execute failed", m_TaskSignature);
+	CACHE_LOG_LIMIT(THREAD_ERROR, TASK_FAILED_LOG_RATE, "Task[{}] execute failed", GetSignature());
 }
 
 void CTask::Run()
 {
+	//Ŷڼ䱻ȡ
+	if (!TryBeginRun())
+	{
+		return;
+	}
 	try
 	{
-		SetState(enTaskState::eTaskDoing);
-		SetStartTime(CTimeHelper::GetSingletonPtr()->GetMSTime());
+		SetStartTime(CTscClock::NowNs());
 		Execute();
+		SetFinishTime(CTscClock::NowNs());
 		OnFinish();
 	}
 	catch (std::exception& e)
 	{
-		CACHE_LOG(THREAD_ERROR, "Task[{}] caught exception,exception msg:{}",m_TaskSignature,e.what());
+		SetFinishTime(CTscClock::NowNs());
+		CACHE_LOG_LIMIT(THREAD_ERROR, TASK_FAILED_LOG_RATE, "Task[{}] caught exception,exception msg:{}",GetSignature(),e.what());
 		OnFailed();
 	}
 }
 
-void CTask::RunChildTask()
+bool CTask::TryBeginRun()
 {
-	TaskPtr pTask;
-	while (true)
+	enTaskState state = GetState();
+	while (state == enTaskState::eTaskInit || state == enTaskState::eTaskWaitingFoDoing)
 	{
+		if (m_nState.compare_exchange_weak(state, enTaskState::eTaskDoing, std::memory_order_acq_rel))
 		{
-			CSafeLock guard(m_childTaskLock);
-			if (m_childTaskQueue.empty())
-			{
-				break;
-			}
-			pTask = m_childTaskQueue.front();
-			m_childTaskQueue.pop();
+			return true;
 		}
-		if (pTask != NULL)
+	}
+	return false;
+}
+
+bool CTask::Cancel()
+{
+	enTaskState state = GetState();
+	while (state == enTaskState::eTaskInit || state == enTaskState::eTaskWaitingFoDoing)
+	{
+		//TryBeginRun,ֻһܳɹ
+		if (m_nState.compare_exchange_weak(state, enTaskState::eTaskCancelled, std::memory_order_acq_rel))
 		{
-			if(pTask->CombinedType() != enCombineType::eCombineNone)
-			{
-				pTask->CombineTaskDone(GetShared());
-			}else
-			{
-				ExecuteChildTask(pTask);
-			}
+			ReleaseResource();
+			RunChildTask();
+			return true;
 		}
 	}
+	return false;
 }
 
-void CTask::SetAcceptCombineInfo(CSafePtr<IArgsTypeInfo> pArgs)
+bool CTask::Reject()
 {
-	if (m_pArgsTypeList != NULL)
+	//CancelRun,ֻһܳɹ
+	if (!TryBeginRun())
 	{
-		ASSERT_EX(false, "This Task has combined once");
+		return false;
 	}
-	m_pArgsTypeList = pArgs;
+	OnFailed();
+	return true;
 }
 
-void CTask::FillCombineTaskArgs(TaskPtr pChildTask)
+void CTask::RunChildTask()
 {
-	if (m_pArgsTypeList != NULL)
+	//ժ,õRunChildTaskõཻ
+	CChildTaskNode* pNode = m_pChildHead.exchange(NULL, std::memory_order_acq_rel);
+	//Ǻӵǰ,ת˳
+	CChildTaskNode* pOrdered = NULL;
+	while (pNode != NULL)
+	{
+		CChildTaskNode* pNext = pNode->m_pNext;
+		pNode->m_pNext = pOrdered;
+		pOrdered = pNode;
+		pNode = pNext;
+	}
+
+	while (pOrdered != NULL)
 	{
-		m_pArgsTypeList->FillWaitTaskParm(GetShared(),pChildTask);
+		TaskPtr pTask = std::move(pOrdered->m_pTask);
+		CChildTaskNode* pNext = pOrdered->m_pNext;
+		delete pOrdered;
+		pOrdered = pNext;
+		if (pTask == NULL)
+		{
+			continue;
+		}
+		try
+		{
+			enCombineType combineType = pTask->CombinedType();
+			if(combineType != enCombineType::eCombineNone)
+			{
+				//ÿǰֻܱһAll,ڵֻᱻһ߳ժ,λֻᱻдһ
+				if (combineType == enCombineType::eCombineAll && GetState() == enTaskState::eTaskDone)
+				{
+					FillCombineSlot();
+				}
+				pTask->CombineTaskDone(GetShared());
+			}else
+			{
+				ExecuteChildTask(pTask);
+			}
+		}
+		catch (...)
+		{
+			//ʣµԭ˳һȥ,´RunChildTask(ʱ)ִ
+			while (pOrdered != NULL)
+			{
+				CChildTaskNode* pRest = pOrdered->m_pNext;
+				PushChildNode(pOrdered);
+				pOrdered = pRest;
+			}
+			throw;
+		}
 	}
 }
@@ -7,18 +7,21 @@
 #ifndef __THREAD_TASK_H__
 #define __THREAD_TASK_H__
 #include <functional>
+#include <cstddef>
 #include <type_traits>
 #include <string>
 #include <tuple>
 #include <memory>
 #include <atomic>
-#include <queue>
 #include "my_thread.h"
 #include "log.h"
 #include "t_array.h"
 
 using namespace my_std;
 
+//ʧ/쳣־ÿõÿ,ιʱʧҲˢIO
+#define TASK_FAILED_LOG_RATE	(100)
+
 class CTaskScheduler;
 typedef std::shared_ptr<CTask> TaskPtr;
 typedef std::weak_ptr<CTask> WeakTaskPtr;
@@ -30,6 +33,7 @@ enum class enTaskState : unsigned char
 	eTaskDoing = 2,
 	eTaskDone = 3,
 	eTaskFailed = 4,
+	eTaskCancelled = 5,		//ûʼִоͱȡ
 };
 
 enum class enCombineType : unsigned char
@@ -125,26 +129,70 @@ public:
 // };
 
 
-class IArgsTypeInfo;
+//,ֻڴʱ־͵ʱ,֮,ռȻ
+struct CTaskColdInfo
+{
+	CTaskColdInfo(std::string signature) : m_TaskSignature(std::move(signature)), m_nEnqueueTime(0), m_nStartTime(0), m_nFinishTime(0), m_bHighPriority(false), m_bUnbounded(false), m_pCombineSlot(NULL)
+	{}
+	std::string							m_TaskSignature;	//ǩ
+	//¶CTscClockʱ
+	uint64								m_nEnqueueTime;		//һνȶеʱ
+	uint64								m_nStartTime;		//ʼִʱ
+	uint64								m_nFinishTime;		//ִн(ɹʧ)ʱ
+	bool								m_bHighPriority;	//ʱŽȼ,Ͷ֮ǰ
+	bool								m_bUnbounded;		//ڲ,ܶ,Ͷ֮ǰ
+	void*								m_pCombineSlot;		//AcceptAllʱԪеĲλ,ǰʱд
+};
+
+//ڵ,AddChildTaskͷ,RunChildTaskժº˳ִ
+struct CChildTaskNode
+{
+	TaskPtr								m_pTask;
+	CChildTaskNode*						m_pNext;
+};
+
 class CTask : public enable_shared_from_this<CTask>
 {
 	friend class CTaskScheduler;
 public:
 	CTask(CSafePtr<CTaskScheduler> scheduler, std::string signature);
 	virtual ~CTask();
-	time_t GetStartTime()						{ return m_nExecuteStart; }
-	const std::string& GetSignature()			{ return m_TaskSignature; }
+	//ʼִеʱ(CTscClock)
+	uint64 GetStartTime()						{ return m_pColdInfo->m_nStartTime; }
+	//ڶеȴ,ûʼִʱΪ0
+	uint64 GetQueueCost()						{ return m_pColdInfo->m_nStartTime > m_pColdInfo->m_nEnqueueTime && m_pColdInfo->m_nEnqueueTime > 0 ? m_pColdInfo->m_nStartTime - m_pColdInfo->m_nEnqueueTime : 0; }
+	//ִкķѵ,ûִʱΪ0
+	uint64 GetRunCost()							{ return m_pColdInfo->m_nFinishTime > m_pColdInfo->m_nStartTime ? m_pColdInfo->m_nFinishTime - m_pColdInfo->m_nStartTime : 0; }
+	const std::string& GetSignature()			{ return m_pColdInfo->m_TaskSignature; }
 	TaskPtr GetShared()							{ return shared_from_this(); }
-	CSafePtr<CTaskScheduler>   GetScheduler()   { return m_pScheduler; }
+	CSafePtr<CTaskScheduler>   GetScheduler()   { return CSafePtr<CTaskScheduler>(m_pScheduler); }
 	//ԭӱyreleasestorey֮ǰstore/loady֮
 	//ԭӱyacquireload˱y֮store/loady֮ǰ
 	enTaskState GetState()						{ return m_nState.load(std::memory_order_acquire); }
+	//ǷѾ(ɡʧܻ߱ȡ),֮ӵҪִ
+	bool IsFinished()
+	{
+		enTaskState state = GetState();
+		return state == enTaskState::eTaskDone || state == enTaskState::eTaskFailed || state == enTaskState::eTaskCancelled;
+	}
 	//
 	void AddChildTask(TaskPtr pTask);
 	//ִ
 	void RunChildTask();
+	//ȶеʱ
+	void SetEnqueueTime(uint64 time)			{ m_pColdInfo->m_nEnqueueTime = time; }
+	//ȼִͨ,ʹõΪԤ֡Ԥ
+	void SetHighPriority(bool bHigh)			{ m_pColdInfo->m_bHighPriority = bHigh; }
+	bool IsHighPriority()						{ return m_pColdInfo->m_bHighPriority; }
+	//strandִΡȵڲ,ʱҲֱ,ᱻܾ߶
+	void SetUnbounded(bool bUnbounded)			{ m_pColdInfo->m_bUnbounded = bUnbounded; }
+	bool IsUnbounded()							{ return m_pColdInfo->m_bUnbounded; }
+	//ΪAcceptAllǰʱ󶨺Ĳλ,ֻܰһ
+	void SetCombineSlot(void* pSlot);
 	//ʼִʱ
-	void SetStartTime(time_t time)				{ m_nExecuteStart = time; }
+	void SetStartTime(uint64 time)				{ m_pColdInfo->m_nStartTime = time; }
+	//ִнʱ
+	void SetFinishTime(uint64 time)				{ m_pColdInfo->m_nFinishTime = time; }
 	//ִ״̬
 	void SetState(enTaskState state)			{ m_nState.store(state, std::memory_order_release);}
 	//ִ
@@ -153,10 +201,10 @@ public:
 	virtual void OnFailed();
 	//ִ
 	void Run();
-	//ǷĲ
-	void SetAcceptCombineInfo(CSafePtr<IArgsTypeInfo> pArgs);
-	//Ĳ
-	void FillCombineTaskArgs(TaskPtr pChildTask);
+	//ȡûʼִе,ʧܴ,Ƿȡɹ
+	bool Cancel();
+	//ܾûʼִе(ʱ),ִʧܴ,Ƿܾɹ
+	bool Reject();
 public:
 	//ִ
 	virtual void  Execute() = 0;
@@ -166,28 +214,70 @@ public:
 	virtual void  ExecuteFromParent(void* pRes,bool sucess = true) = 0;
 	//ȡִн
 	virtual void* GetRes() = 0;
+	//ȡͷſִж䲶Դ
+	virtual void  ReleaseResource() {}
+protected:
+	//ӵȴִ״̬лִ״̬,ѾȡѾִй򷵻false
+	bool TryBeginRun();
+	void* GetCombineSlot()						{ return m_pColdInfo->m_pCombineSlot; }
 public:
-	//ȡִв
-	virtual void* GetCombinedArgsTuple() {return NULL;};
+	//ִндAllԪжӦĲλ
+	virtual void  FillCombineSlot() {}
 	//
 	virtual enCombineType  CombinedType() {return enCombineType::eCombineNone;}
 	//ִ
 	virtual void  CombineTaskDone(TaskPtr pParentTask)  {ASSERT_EX(false,"NOT Combinetask call CombineTaskDone illegal");}
 	//
 	virtual void  SetCombineTask(int index,TaskPtr pTask) {ASSERT_EX(false,"NOT Combinetask call SetCombineTask illegal");}
+private:
+	//һڵҵͷ
+	void PushChildNode(CChildTaskNode* pNode);
 protected:
-	CMyLock								m_childTaskLock;
-	std::string							m_TaskSignature;	//ǩ
-	time_t								m_nExecuteStart;	//ʼִʱ
-	//ִɺҪִеĺ
-	std::queue<TaskPtr>					m_childTaskQueue;
+	/**
+	 * :ָ롢shared_from_thisáִ״̬ͷָ
+	 * һһ(64λ56ֽ)
+	 * Ŀִжӵ56ֽڿʼ,std::function64λռ32ֽ,24ֽ(ָ)ڵڶ
+	 * Ŀִжϼ֮,CCombineTask
+	 * ָ뱣,CSafePtr64λռ16ֽ,_DEBUG_»Ҫٷ
+	 */
 	//ǰִ״̬
 	std::atomic<enTaskState>			m_nState;
-	//ǰһǰ񣬱ΪǰĲλϢ
-	CSafePtr<IArgsTypeInfo>				m_pArgsTypeList;
-	CSafePtr<CTaskScheduler>			m_pScheduler;
+	CTaskScheduler*						m_pScheduler;
+	//ִɺҪִеĺ(ӵͷ)
+	std::atomic<CChildTaskNode*>		m_pChildHead;
+	CTaskColdInfo*						m_pColdInfo;
 };
 
+//ͷڴԤ,ֶǰȿܷŵCTaskColdInfo
+static_assert(sizeof(CTask) <= CACHE_LINE_SIZE, "CTask hot fields must fit in one cache line");
+
+//͵ĳԱƫ,Ǳ׼,gccoffsetof澯,ֻص
+#ifdef __LINUX__
+#define TASK_LAYOUT_ASSERT(expr, msg) \
+	_Pragma("GCC diagnostic push") \
+	_Pragma("GCC diagnostic ignored \"-Winvalid-offsetof\"") \
+	static_assert(expr, msg); \
+	_Pragma("GCC diagnostic pop")
+#else
+#define TASK_LAYOUT_ASSERT(expr, msg) static_assert(expr, msg);
+#endif
+
+//m_combineDoneǰֽ,ǰбһʱ
+#define TASK_COMBINE_PAD(count) ((count) * sizeof(WeakTaskPtr) < CACHE_LINE_SIZE ? CACHE_LINE_SIZE - (count) * sizeof(WeakTaskPtr) : 1)
+
+//make_sharedƿĴС(ָ+ǿü),׼ʵֻһ
+#define TASK_SHARED_CTRL_SIZE	(sizeof(void*) + 2 * sizeof(int))
+
+/**
+ * һռõֽ:(make_sharedƿ)++ÿһڵ
+ * ǩַͿִж󲶻Ķڴ
+ */
+template<class TaskType>
+inline size_t PendingTaskBytes(size_t nChildCount = 0)
+{
+	return sizeof(TaskType) + TASK_SHARED_CTRL_SIZE + sizeof(CTaskColdInfo) + nChildCount * sizeof(CChildTaskNode);
+}
+
 template<int combine_count>
 class CCombineTask : public CTask
 {
@@ -197,7 +287,9 @@ public:
 					enCombineType combineType = enCombineType::eCombineAll)
 		: CTask(scheduler, signature)
 	{
+		TASK_LAYOUT_ASSERT(offsetof(CCombineTask, m_combineDone) >= sizeof(CTask) + CACHE_LINE_SIZE, "m_combineDone must be a cache line away from the task header")
 		m_combineDone = 0;
+		m_bAnyWinner = false;
 		m_combineType = combineType;
 	}
 	
@@ -212,33 +304,42 @@ public:
 
 	virtual void OnFailed() 
 	{
+		//ѾȡѾ
+		if (GetState() == enTaskState::eTaskCancelled)
+		{
+			return;
+		}
 		SetState(enTaskState::eTaskFailed);
 		RunChildTask();
-		CACHE_LOG(THREAD_ERROR, "Task[{}] execute failed", m_TaskSignature);
+		CACHE_LOG_LIMIT(THREAD_ERROR, TASK_FAILED_LOG_RATE, "Task[{}] execute failed", this->GetSignature());
 	}
 
 	virtual void  SetCombineTask(int index,TaskPtr pTask)
 	{
-		// CSafeLock lock(m_combineLock);
-		// if(index >= 0 && index < combine_count)
-		// {
-		// 	if(m_pCombineTask[index].lock() == NULL)
-		// 	{
-		// 		m_pCombineTask[index] = pTask;
-		// 	}else
-		// 	{
-		// 		ASSERT_EX(false,"SetCombineTask index has set");
-		// 	}
-		// }else
-		// {
-		// 	ASSERT_EX(false,"SetCombineTask index overflow");
-		// }
+		//ֻAnyҪ¼ǰ,ѡʤߺȡǰ
+		if (m_combineType != enCombineType::eCombineAny)
+		{
+			return;
+		}
+		if(index >= 0 && index < combine_count)
+		{
+			m_pCombineTask[index] = pTask;
+		}else
+		{
+			ASSERT_EX(false,"SetCombineTask index overflow");
+		}
 	}
 	
 	virtual void CombineTaskDone(TaskPtr pParentTask)
 	{
-		//ǰִʧ
-		if(pParentTask->GetState() == enTaskState::eTaskFailed)
+		if (m_combineType == enCombineType::eCombineAny)
+		{
+			AnyCombineTaskDone(pParentTask);
+			return;
+		}
+
+		//ǰִʧ˻߱ȡ
+		if(pParentTask->GetState() != enTaskState::eTaskDone)
 		{
 			OnFailed();
 			return;
@@ -251,9 +352,7 @@ public:
 			return;
 		}
 		
-		//֮ǰȰǰķֵдĲб
-		pParentTask->FillCombineTaskArgs(GetShared());
-
+		//ǰķֵRunChildTaskѾдĲλ
 		// fetch_add(1) ֤ԭԵ
 		const int oldValue = m_combineDone.fetch_add(1, std::memory_order_acq_rel);
 		const int newValue = oldValue + 1;
@@ -265,29 +364,59 @@ public:
 				m_pScheduler->PushTask(GetShared());
 			}
 		}
-		else if(m_combineType == enCombineType::eCombineAny)
+	}
+
+public:
+	virtual enCombineType  CombinedType() {return m_combineType;}
+private:
+	/**
+	 * Any:һɹɵǰʤ,ִȡûʼִеǰ
+	 * ǰʧ(ȡ)ʱʧ,ȡǰٱϻʽ
+	 */
+	void AnyCombineTaskDone(TaskPtr pParentTask)
+	{
+		if (pParentTask->GetState() != enTaskState::eTaskDone)
 		{
-			//һǰˣĲִ
-			if (newValue == 1)
+			const int oldValue = m_combineDone.fetch_add(1, std::memory_order_acq_rel);
+			if (oldValue + 1 == combine_count)
 			{
-				pParentTask->ExecuteChildTask(GetShared());
+				OnFailed();
 			}
-			// else
-			// {
-			// 	int aaa = 0;
-			// }
+			return;
 		}
-	}
 
-public:
-	virtual enCombineType  CombinedType() {return m_combineType;}
+		bool bExpected = false;
+		if (!m_bAnyWinner.compare_exchange_strong(bExpected, true, std::memory_order_acq_rel))
+		{
+			//Ѿǰʤ
+			return;
+		}
+		pParentTask->ExecuteChildTask(GetShared());
+
+		//ʤѡͷŶǰ,ȡŶӵǰ
+		for (int index = 0; index < combine_count; ++index)
+		{
+			TaskPtr pLoserTask = m_pCombineTask[index].lock();
+			m_pCombineTask[index].reset();
+			if (pLoserTask != NULL && pLoserTask != pParentTask)
+			{
+				pLoserTask->Cancel();
+			}
+		}
+	}
 private:
-	//combine info
-	//CMyLock								m_combineLock;
-	//ǰб
-	//TArray<WeakTaskPtr,combine_count>	m_pCombineTask;
-	//ǰһϲĺǰɵ
+	//Anyϵǰб,ֻѡʤߵ߳Ϸ
+	WeakTaskPtr							m_pCombineTask[combine_count];
+	/**
+	 * make_shared(c++17֮ǰ)֤ж,ﲻCACHE_LINE_ALIGN,ǰƫ:
+	 * m_combineDoneͷĩβһ,ܶĸַʼͷͬһ
+	 */
+	char								m_CombinePad[TASK_COMBINE_PAD(combine_count)];
+	//ǰһϲĺǰɵ(AnyʱΪʧܵ)
+	//ǰ̻߳ͬʱ޸,ͷ״ָ̬α
 	std::atomic_int						m_combineDone;
+	//AnyǷѾǰʤ
+	std::atomic_bool					m_bAnyWinner;
 	//ϲ
 	enCombineType						m_combineType;
 };
@@ -303,8 +432,26 @@ public:
 	{}
 };
 
+/**
+ * ǰ񷵻ֵ͵ı,AcceptAll󶨲λʱdynamic_castͺͺĲһ
+ * λָCTaskColdInfo,ûгԱ,ռĿռ,ִжܽͷ֮
+ */
+template<typename R>
+class CCombineSlot
+{
+protected:
+	//pSlotֱָAllԪͬԪ
+	static void FillSlot(void* pSlot, const R& res)
+	{
+		if (pSlot != NULL)
+		{
+			*(R*)pSlot = res;
+		}
+	}
+};
+
 template<int combine_count,class Func, class...Args>
-class CWithReturnTask : public CCombineTask<combine_count>
+class CWithReturnTask : public CCombineTask<combine_count>, public CCombineSlot<typename std::result_of<Func(Args...)>::type>
 {
 	enum
 	{
@@ -328,6 +475,8 @@ public:
 		enCombineType combineType = enCombineType::eCombineAll)
 		: CCombineTask<combine_count>(scheduler, signature, combineType)
 	{
+		//Ŀִж56ֽڵͷ֮,ӵһڿʼ
+		TASK_LAYOUT_ASSERT(combine_count > 0 || offsetof(CWithReturnTask, m_Func) == sizeof(CTask), "callable must follow the task header")
 		m_Func = std::forward<Func>(func);
 	}
 	virtual ~CWithReturnTask()
@@ -355,18 +504,26 @@ public:
 		ASSERT_EX(false, "<class Func, class...Args>CWithReturnTask can not ExecuteFromParent");
 	}
 
+	virtual void  ReleaseResource()
+	{
+		m_Func = nullptr;
+	}
+
 	virtual void* GetRes()
 	{
 		return (void*)(&m_Res);
 	}
-	virtual void* GetCombinedArgsTuple()
+
+	virtual void  FillCombineSlot()
 	{
-		return (void*)(&m_ArgTuple);
+		this->FillSlot(this->GetCombineSlot(), m_Res);
 	}
 
-	virtual void  FillCombineTaskArgs(TaskPtr pChildTask)
+	//AllʱIǰдλ
+	template<size_t I>
+	typename args<I>::type* GetArgSlot()
 	{
-		this->m_pCombinedArgs->FillWaitTaskParm(this->GetShared(),pChildTask);
+		return &std::get<I>(m_ArgTuple);
 	}
 
 private:
@@ -376,7 +533,7 @@ private:
 };
 
 template<int combine_count,class Func, typename Par>
-class CWithReturnTask<combine_count,Func,Par> : public CCombineTask<combine_count>
+class CWithReturnTask<combine_count,Func,Par> : public CCombineTask<combine_count>, public CCombineSlot<typename std::result_of<Func(Par)>::type>
 {
 	using return_type = typename std::result_of<Func(Par)>::type;
 	using function_type = typename std::function<return_type(Par)>;
@@ -387,6 +544,8 @@ public:
 		enCombineType combineType = enCombineType::eCombineAll)
 		: CCombineTask<combine_count>(scheduler, signature, combineType)
 	{
+		//Ŀִж56ֽڵͷ֮,ӵһڿʼ
+		TASK_LAYOUT_ASSERT(combine_count > 0 || offsetof(CWithReturnTask, m_Func) == sizeof(CTask), "callable must follow the task header")
 		m_Func = std::forward<Func>(func);
 	}
 	virtual ~CWithReturnTask()
@@ -420,14 +579,27 @@ public:
 		}
 	}
 
+	virtual void  ReleaseResource()
+	{
+		m_Func = nullptr;
+	}
+
 	virtual void* GetRes()
 	{
 		return (void*)(&m_Res);
 	}
 
-	virtual void* GetCombinedArgsTuple()
+	virtual void  FillCombineSlot()
 	{
-		return NULL;
+		this->FillSlot(this->GetCombineSlot(), m_Res);
+	}
+
+	//Allֻһǰʱдλ
+	template<size_t I>
+	Par* GetArgSlot()
+	{
+		static_assert(I == 0, "index is out of range, index must be 0");
+		return &m_Param;
 	}
 
 private:
@@ -437,7 +609,7 @@ private:
 };
 
 template<int combine_count,class Func>
-class CWithReturnTask<combine_count,Func,void> : public CCombineTask<combine_count>
+class CWithReturnTask<combine_count,Func,void> : public CCombineTask<combine_count>, public CCombineSlot<typename std::result_of<Func()>::type>
 {
 	using return_type = typename std::result_of<Func()>::type;
 	using function_type = typename std::function<return_type()>;
@@ -448,6 +620,8 @@ public:
 					enCombineType combineType = enCombineType::eCombineAll)
 		: CCombineTask<combine_count>(scheduler, signature, combineType)
 	{
+		//Ŀִж56ֽڵͷ֮,ӵһڿʼ
+		TASK_LAYOUT_ASSERT(combine_count > 0 || offsetof(CWithReturnTask, m_Func) == sizeof(CTask), "callable must follow the task header")
 		m_Func = std::forward<Func>(func);
 	}
 
@@ -483,14 +657,19 @@ public:
 		}
 	}
 
+	virtual void  ReleaseResource()
+	{
+		m_Func = nullptr;
+	}
+
 	virtual void* GetRes()
 	{
 		return (void*)(&m_Res);
 	}
 
-	virtual void* GetCombinedArgsTuple()
+	virtual void  FillCombineSlot()
 	{
-		return NULL;
+		this->FillSlot(this->GetCombineSlot(), m_Res);
 	}
 
 private:
@@ -522,6 +701,8 @@ public:
 		enCombineType combineType = enCombineType::eCombineAll)
 		: CCombineTask<combine_count>(scheduler, signature, combineType)
 	{
+		//Ŀִж56ֽڵͷ֮,ӵһڿʼ
+		TASK_LAYOUT_ASSERT(combine_count > 0 || offsetof(CNoReturnTask, m_Func) == sizeof(CTask), "callable must follow the task header")
 		m_Func = std::forward<Func>(func);
 	}
 	virtual ~CNoReturnTask()
@@ -550,14 +731,21 @@ public:
 		ASSERT_EX(false, "<class Func, class...Args>CNoReturnTask can not ExecuteFromParent");
 	}
 
+	virtual void  ReleaseResource()
+	{
+		m_Func = nullptr;
+	}
+
 	virtual void* GetRes()
 	{
 		return NULL;
 	}
 
-	virtual void* GetCombinedArgsTuple()
+	//AllʱIǰдλ
+	template<size_t I>
+	typename args<I>::type* GetArgSlot()
 	{
-		return (void*)(&m_ArgTuple);
+		return &std::get<I>(m_ArgTuple);
 	}
 
 private:
@@ -576,6 +764,8 @@ public:
 		enCombineType combineType = enCombineType::eCombineAll)
 		:CCombineTask<combine_count>(scheduler, signature, combineType)
 	{
+		//Ŀִж56ֽڵͷ֮,ӵһڿʼ
+		TASK_LAYOUT_ASSERT(combine_count > 0 || offsetof(CNoReturnTask, m_Func) == sizeof(CTask), "callable must follow the task header")
 		m_Func = std::forward<Func>(func);
 	}
 	virtual ~CNoReturnTask()
@@ -611,15 +801,24 @@ public:
 		}
 	}
 
+	virtual void  ReleaseResource()
+	{
+		m_Func = nullptr;
+	}
+
 	virtual void* GetRes()
 	{
 		return NULL;
 	}
 
-	virtual void* GetCombinedArgsTuple()
+	//Allֻһǰʱдλ
+	template<size_t I>
+	Par* GetArgSlot()
 	{
-		return NULL;
+		static_assert(I == 0, "index is out of range, index must be 0");
+		return &m_Param;
 	}
+
 private:
 	function_type			m_Func;
 	Par						m_Param;
@@ -636,6 +835,8 @@ public:
 		enCombineType combineType = enCombineType::eCombineAll)
 		:CCombineTask<combine_count>(scheduler, signature, combineType)
 	{
+		//Ŀִж56ֽڵͷ֮,ӵһڿʼ
+		TASK_LAYOUT_ASSERT(combine_count > 0 || offsetof(CNoReturnTask, m_Func) == sizeof(CTask), "callable must follow the task header")
 		m_Func = std::forward<Func>(func);
 	}
 	virtual ~CNoReturnTask()
@@ -668,15 +869,16 @@ public:
 			this->OnFailed();
 		}
 	}
-	virtual void* GetRes()
+	virtual void  ReleaseResource()
 	{
-		return NULL;
+		m_Func = nullptr;
 	}
 
-	virtual void* GetCombinedArgsTuple()
+	virtual void* GetRes()
 	{
 		return NULL;
 	}
+
 	
 private:
 	function_type			m_Func;
@@ -6,33 +6,38 @@
 ******************************************************************/
 #ifndef __TASK_HELPER_H__
 #define __TASK_HELPER_H__
+#include <vector>
 #include "my_assert.h"
 #include "safe_pointer.h"
+#include "spin_lock.h"
 #include "task.h"
 
 class CTaskScheduler;
 
+//ؾ,AcceptAllҪͨǰ󶨵λ
 template<int combine_count,typename return_type, class Func,typename ...Args>
 struct CombineTaskCreater
 {
-	static TaskPtr CreateTask(CSafePtr<CTaskScheduler> scheduler,
+	typedef CWithReturnTask<combine_count,Func, Args...> TaskType;
+	static std::shared_ptr<TaskType> CreateTask(CSafePtr<CTaskScheduler> scheduler,
 								std::string signature,
 								Func&& f,
 								enCombineType combineType = enCombineType::eCombineAll)
 	{
-		return std::make_shared<CWithReturnTask<combine_count,Func, Args...>>(scheduler, signature, std::forward<Func>(f), combineType);
+		return std::make_shared<TaskType>(scheduler, signature, std::forward<Func>(f), combineType);
 	}
 };
 
 template<int combine_count,class Func, typename ...Args>
 struct CombineTaskCreater<combine_count,void,Func,Args...>
 {
-	static TaskPtr CreateTask(CSafePtr<CTaskScheduler> scheduler,
+	typedef CNoReturnTask<combine_count,Func, Args...> TaskType;
+	static std::shared_ptr<TaskType> CreateTask(CSafePtr<CTaskScheduler> scheduler,
 								std::string signature,
 								Func&& f,
 								enCombineType combineType = enCombineType::eCombineAll)
 	{
-		return std::make_shared<CNoReturnTask<combine_count,Func, Args...>>(scheduler, signature, std::forward<Func>(f), combineType);
+		return std::make_shared<TaskType>(scheduler, signature, std::forward<Func>(f), combineType);
 	}
 };
 
@@ -108,8 +113,7 @@ public:
 		std::shared_ptr<CTask> pChildTask = TaskCreater<return_type, Res,Func>::CreateTask(scheduler.Get(), signature, std::forward<Func>(func));
 		m_pTaskPtr->AddChildTask(pChildTask);
 		//пӵ֮ǰǰѾˣûִУٴγִ
-		if (m_pTaskPtr->GetState() == enTaskState::eTaskDone 
-			|| m_pTaskPtr->GetState() == enTaskState::eTaskFailed)
+		if (m_pTaskPtr->IsFinished())
 		{ 
 			m_pTaskPtr->RunChildTask();
 		}
@@ -143,8 +147,7 @@ public:
 		std::shared_ptr<CTask> pChildTask = TaskCreater<return_type, void, Func>::CreateTask(scheduler.Get(), signature, std::forward<Func>(func));
 		m_pTaskPtr->AddChildTask(pChildTask);
 		//пӵ֮ǰǰѾˣûִУٴγִ
-		if (m_pTaskPtr->GetState() == enTaskState::eTaskDone
-			|| m_pTaskPtr->GetState() == enTaskState::eTaskFailed)
+		if (m_pTaskPtr->IsFinished())
 		{
 			m_pTaskPtr->RunChildTask();
 		}
@@ -213,15 +216,16 @@ public:
 	template<class Scheduler,class Func, typename return_type = typename std::result_of<Func(Args...)>::type>
 	CTaskHelper<return_type> AcceptAll(CSafePtr<Scheduler> scheduler,Func&& func)
 	{
+		typedef CombineTaskCreater<arity,return_type,Func,Args...> Creater;
 		std::string signature = m_TaskList[0]->GetSignature() + "_AcceptAll";
-		std::shared_ptr<CTask> pTask = CombineTaskCreater<arity,return_type,Func,Args...>::CreateTask(scheduler.Get(),signature, std::forward<Func>(func));
+		std::shared_ptr<typename Creater::TaskType> pTask = Creater::CreateTask(scheduler.Get(),signature, std::forward<Func>(func));
+		//֮ǰȰÿǰ󶨵ԪжӦĲλ
+		BindCombineSlots(pTask, typename MakeIndexSequence<arity>::type());
 		for(int index = 0; index < m_TaskList.size(); ++index)
 		{
-			pTask->SetCombineTask(index, m_TaskList[index]);
 			m_TaskList[index]->AddChildTask(pTask);
 			//пӵ֮ǰǰѾˣûִУٴγִ
-			if (m_TaskList[index]->GetState() == enTaskState::eTaskDone
-				|| m_TaskList[index]->GetState() == enTaskState::eTaskFailed)
+			if (m_TaskList[index]->IsFinished())
 			{
 				m_TaskList[index]->RunChildTask();
 			}
@@ -230,6 +234,10 @@ public:
 		return CTaskHelper<return_type>(pTask);
 	}
 
+	/**
+	 * һɹɵǰĽΪִfunc,Ŷӵǰᱻȡ
+	 * ȡǰʧ֪ͨ,ЩǰֻӦñһ
+	 */
 	template<class Scheduler, class Func, typename FirstArg = typename args<0>::type,typename return_type = typename std::result_of<Func(FirstArg)>::type>  
 	CTaskHelper<return_type> AcceptAny(CSafePtr<Scheduler> scheduler,Func&& func)
 	{
@@ -237,19 +245,43 @@ public:
     	static_assert(are_all_same<Args...>::value, "AcceptAny All arguments must be the same type");
 		std::string signature = m_TaskList[0]->GetSignature() + "_AcceptAny";
 		std::shared_ptr<CTask> pTask = CombineTaskCreater<arity,return_type,Func,FirstArg>::CreateTask(scheduler.Get(),signature, std::forward<Func>(func), enCombineType::eCombineAny);
+		//ȼ¼ȫǰٹ,ǰڹعоɲʼȡǰ
 		for(int index = 0; index < m_TaskList.size(); ++index)
 		{
 			pTask->SetCombineTask(index, m_TaskList[index]);
+		}
+		for(int index = 0; index < m_TaskList.size(); ++index)
+		{
 			m_TaskList[index]->AddChildTask(pTask);
 			//пӵ֮ǰǰѾˣûִУٴγִ
-			if (m_TaskList[index]->GetState() == enTaskState::eTaskDone
-				|| m_TaskList[index]->GetState() == enTaskState::eTaskFailed)
+			if (m_TaskList[index]->IsFinished())
 			{
 				m_TaskList[index]->RunChildTask();
 			}
 		}
 		return CTaskHelper<return_type>(pTask);
 	}
+private:
+	template<class TaskType, size_t... Indices>
+	void BindCombineSlots(std::shared_ptr<TaskType>& pTask, IndexSequence<Indices...>)
+	{
+		int expand[] = { 0, (BindCombineSlot<Indices>(pTask), 0)... };
+		(void)expand;
+	}
+
+	template<size_t I, class TaskType>
+	void BindCombineSlot(std::shared_ptr<TaskType>& pTask)
+	{
+		using ArgType = typename args<I>::type;
+		//ǰķͱͲλһ,ֻϽʱһ,ʱֱӰд
+		CCombineSlot<ArgType>* pSlot = dynamic_cast<CCombineSlot<ArgType>*>(m_TaskList[I].get());
+		if (pSlot == NULL)
+		{
+			ASSERT_EX(false, "AcceptAll parent task has no combine slot");
+			return;
+		}
+		m_TaskList[I]->SetCombineSlot(pTask->template GetArgSlot<I>());
+	}
 private:
 	std::vector<TaskPtr>		m_TaskList;
 };
@@ -279,98 +311,190 @@ public:
 		for(int index = 0; index < m_TaskList.size(); ++index)
 		{
 			m_TaskList[index]->AddChildTask(pTask);
-			pTask->SetCombineTask(index, m_TaskList[index]);
+			//пӵ֮ǰǰѾˣûִУٴγִ
+			if (m_TaskList[index]->IsFinished())
+			{
+				m_TaskList[index]->RunChildTask();
+			}
 		}
 		return CTaskHelper<return_type>(pTask);
 	}
 
+	//һɹɵǰ񴥷func,Ŷӵǰᱻȡ
 	template<class Scheduler,class Func, typename return_type = typename std::result_of<Func()>::type>
 	CTaskHelper<return_type> ApplyAny(CSafePtr<Scheduler> scheduler,Func&& func)
 	{
 		std::string signature = m_TaskList[0]->GetSignature() + "_ApplyAny";
 		std::shared_ptr<CTask> pTask = CombineTaskCreater<combine_count,return_type, Func, void>::CreateTask(scheduler.Get(), signature, std::forward<Func>(func), enCombineType::eCombineAny);
+		//ȼ¼ȫǰٹ,ǰڹعоɲʼȡǰ
 		for(int index = 0; index < m_TaskList.size(); ++index)
 		{
-			m_TaskList[index]->AddChildTask(pTask);
 			pTask->SetCombineTask(index, m_TaskList[index]);
 		}
+		for(int index = 0; index < m_TaskList.size(); ++index)
+		{
+			m_TaskList[index]->AddChildTask(pTask);
+			//пӵ֮ǰǰѾˣûִУٴγִ
+			if (m_TaskList[index]->IsFinished())
+			{
+				m_TaskList[index]->RunChildTask();
+			}
+		}
 		return CTaskHelper<return_type>(pTask);
 	}
 private:
 	std::vector<TaskPtr>		m_TaskList;
 };
 
-class IArgsTypeInfo
+//ʱϵĹ,ԭӼʱͷŽ
+struct CFanInContext
 {
-public:
-	IArgsTypeInfo() {};
-	virtual ~IArgsTypeInfo() {};
-	virtual void  FillWaitTaskParm(TaskPtr pTask,TaskPtr pWaitTask) = 0;
-	virtual bool  Empty() = 0;
+	std::atomic<size_t>					m_nRemain;		//δɵǰ
+	std::atomic_bool					m_bFailed;
+	TaskPtr								m_pDoneTask;	//ǰɺִе
+
+	CFanInContext(size_t count)
+	{
+		m_nRemain.store(count);
+		m_bFailed.store(false);
+	}
+
+	void SlotDone()
+	{
+		//acq_rel֤һɵ߳ܿ߳дĽ
+		if (m_nRemain.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			Release();
+		}
+	}
+
+	//һɵǰֱִ߳н,پת
+	void Release()
+	{
+		TaskPtr pDoneTask = m_pDoneTask;
+		m_pDoneTask = NULL;
+		pDoneTask->SetState(enTaskState::eTaskWaitingFoDoing);
+		pDoneTask->Run();
+	}
 };
 
-template<int combineIndex,typename ...Args>
-class CArgsTypeList : public IArgsTypeInfo
+//WhenAll,ÿǰ±дԼĲλ,ͻ,Ҫ
+template<typename T>
+struct CWhenAllContext : public CFanInContext
 {
-	enum
-    {
-        arity = sizeof...(Args)
-    };
-
-	/*
-		Args... Ѿֵ֧ãArgs... ΪģԽֵܰڵ͡
-		Args&&... ãArgs&&... ͨںУΪͨõĲڽ
-		Ĳǵֵ𡣵 CArgsHolder УArgs... ڶ std::tuple ͣ
-		Ϊ˲Ҫʹ Args&&...
-		£Ҫʹ Args&&...
-		template <typename... Args>
-		void forwarder(Args&&... args) {
-			function_that_needs_args(std::forward<Args>(args)...);
-		}
-	*/
-    using ParamTypeElement = typename std::tuple<Args...>;
-    template<size_t I>
-    struct args
-    {
-        static_assert(I < arity, "index is out of range, index must less than sizeof Args");
-        using type = typename std::tuple_element<I, ParamTypeElement>::type;
-    };
-public:
-	virtual void  FillWaitTaskParm(TaskPtr pParentTask,TaskPtr pChildTask)
+	//std::vector<bool>λ洢,ͬ±ͬһֽ,޷д
+	static_assert(!std::is_same<T, bool>::value, "WhenAll not support bool result");
+
+	std::vector<T>						m_Results;		//±ԤõĽλ
+
+	CWhenAllContext(size_t count) : CFanInContext(count), m_Results(count)
+	{}
+
+	void Fill(size_t index, const T& res)
 	{
-		void* pRes = pParentTask->GetRes();
-		void* pArgs = pChildTask->GetCombinedArgsTuple();
-		if (pRes == NULL || pArgs == NULL)
+		m_Results[index] = res;
+	}
+};
+
+#define REDUCE_PARTIAL_SLOTS 16		//WhenAllReduceÿֽ̲߳Ĳλ
+
+//̵߳Ĳֽ,жⲻ̵ͬ߳Ĳλα,ҪCCacheLineAllocator
+template<typename T>
+struct CACHE_LINE_ALIGN CReducePartial
+{
+	CSpinLock							m_Lock;
+	bool								m_bHas;
+	T									m_Value;
+	CReducePartial() : m_Lock("CReducePartial::m_Lock"), m_bHas(false), m_Value() {}
+};
+
+//WhenAllReduce,ǰĽ۵ǰ̵߳Ĳֽ,浥
+template<typename T, class Op>
+struct CWhenAllReduceContext : public CFanInContext
+{
+	Op									m_Op;
+	T									m_Init;
+	CReducePartial<T>					m_Partials[REDUCE_PARTIAL_SLOTS];
+
+	CWhenAllReduceContext(size_t count, T init, Op&& op)
+		: CFanInContext(count), m_Op(std::forward<Op>(op)), m_Init(init)
+	{}
+
+	void Fill(size_t index, const T& res)
+	{
+		//ͬһ߳ͬһλ,ֻ߳λʱŻо
+		CReducePartial<T>& partial = m_Partials[g_thread_data.getThreadIndex() % REDUCE_PARTIAL_SLOTS];
+		CSafeSpLock guard(partial.m_Lock);
+		if (partial.m_bHas)
 		{
-			return;
+			partial.m_Value = m_Op(partial.m_Value, res);
+		}
+		else
+		{
+			partial.m_Value = res;
+			partial.m_bHas = true;
 		}
-		ParamTypeElement& tmArgs = *(ParamTypeElement*)(pArgs);
-		using ArgType = typename args<combineIndex>::type;
-		ArgType& tmRes = *(ArgType*)(pRes);
-        // ʹ std::forward ֵ
-        std::get<combineIndex>(tmArgs) = std::forward<ArgType>(tmRes);
 	}
 
-	virtual bool Empty()
+	//ǰɺֻһ̵߳,ϲλĲֽ
+	T Merge()
 	{
-		return false;
+		T result = m_Init;
+		for (int index = 0; index < REDUCE_PARTIAL_SLOTS; ++index)
+		{
+			if (m_Partials[index].m_bHas)
+			{
+				result = m_Op(result, m_Partials[index].m_Value);
+			}
+		}
+		return result;
 	}
 };
 
-template<int combineIndex>
-class CArgsTypeList<combineIndex,void>
+//ÿǰϵ,ǰɺֱǰ߳ϰѽ
+template<typename T, class Context>
+class CFanInSlotTask : public CTask
 {
 public:
-	virtual void FillWaitTaskParm(TaskPtr pTask, TaskPtr pWaitTask)
+	CFanInSlotTask(CSafePtr<CTaskScheduler> scheduler,
+					std::shared_ptr<Context> pContext,
+					size_t index)
+		: CTask(scheduler, "FanInSlot"), m_pContext(pContext), m_nIndex(index)
+	{}
+
+	virtual ~CFanInSlotTask()
+	{}
+
+	virtual void Execute()
+	{
+		ASSERT_EX(false, "CFanInSlotTask can not Execute");
+	}
+
+	virtual void ExecuteChildTask(TaskPtr pChildTask)
+	{}
+
+	virtual void ExecuteFromParent(void* pRes, bool sucess = true)
 	{
-		return;
+		if (pRes != NULL && sucess)
+		{
+			m_pContext->Fill(m_nIndex, *(T*)(pRes));
+			SetState(enTaskState::eTaskDone);
+		}
+		else
+		{
+			m_pContext->m_bFailed.store(true, std::memory_order_relaxed);
+			SetState(enTaskState::eTaskFailed);
+		}
+		m_pContext->SlotDone();
 	}
 
-	virtual bool  Empty()
+	virtual void* GetRes()
 	{
-		return true;
+		return NULL;
 	}
+private:
+	std::shared_ptr<Context>			m_pContext;
+	size_t								m_nIndex;
 };
 
-
 #endif //__TASK_HELPER_H__
@@ -1,10 +1,27 @@
 #include "task_scheduler.h"
 
+//ǰִ߳ĸ,ʱ߳Լ
+static thread_local CTaskScheduler* t_pConsumingScheduler = NULL;
+
 CTaskScheduler::CTaskScheduler(std::string signature)
-	:m_Signature(signature)
+	:m_Signature(signature),
+	m_nPriorityReserve(0),
+	m_nCarryOver(0),
+	m_nCarryOverTicks(0),
+	m_nQueueCapacity(0),
+	m_eOverflow(eQueueOverflowBlock),
+	m_nHighWaterMark(0),
+	m_bHighWater(false),
+	m_nSpaceWaiters(0)
 {
-    time_t nNow = CTimeHelper::GetSingletonPtr()->GetMSTime();
-	debug_timer.BeginTimer(nNow, THREAD_TASK_DEBUG_TIME);
+	m_nDelayTaskCount.store(0);
+	for (int index = 0; index < eQueueOverflowCount; index++)
+	{
+		m_nOverflowCount[index].store(0);
+	}
+	LOCK_PROFILE_NAME(m_queue_mutex, "CTaskScheduler::m_queue_mutex");
+	LOCK_PROFILE_NAME(m_delay_mutex, "CTaskScheduler::m_delay_mutex");
+	debug_timer.BeginTimer(THREAD_TASK_DEBUG_TIME);
 }
 
 CTaskScheduler::~CTaskScheduler()
@@ -15,60 +32,322 @@ CTaskScheduler::~CTaskScheduler()
         m_Tasks.pop();
         pTask = NULL;
     }
+    while (!m_HighTasks.empty())
+    {
+        m_HighTasks.pop();
+    }
+    m_DelayTasks.clear();
+}
+
+int CTaskScheduler::ConsumeTask(int nMaxTasks, uint64 nMaxMicros)
+{
+	CTaskScheduler* pLastScheduler = t_pConsumingScheduler;
+	t_pConsumingScheduler = this;
+	ProcessDelayTask();
+	bool bBudget = nMaxTasks > 0 || nMaxMicros > 0;
+	//ͨõԤ,ʣµȼ
+	int nNormalPercent = TASK_PRIORITY_RESERVE_MAX - m_nPriorityReserve;
+	int nTaskLimit = nMaxTasks > 0 ? nMaxTasks : INT_MAX;
+	//ȡ,ԤСʱͨҲִ,ֻȫԤʱΪ0
+	int nNormalLimit = nMaxTasks > 0 ? (nMaxTasks * nNormalPercent + TASK_PRIORITY_RESERVE_MAX - 1) / TASK_PRIORITY_RESERVE_MAX : INT_MAX;
+	uint64 nStart = nMaxMicros > 0 ? CTscClock::NowNs() : 0;
+	uint64 nDeadline = nMaxMicros > 0 ? nStart + nMaxMicros * 1000 : UINT64_MAX;
+	uint64 nNormalDeadline = nMaxMicros > 0 ? nStart + nMaxMicros * 1000 * nNormalPercent / TASK_PRIORITY_RESERVE_MAX : UINT64_MAX;
+	int nCount = 0;
+	int nNormalCount = 0;
+	while (nCount < nTaskLimit)
+	{
+		uint64 nNow = nMaxMicros > 0 ? CTscClock::NowNs() : 0;
+		if (nNow >= nDeadline)
+		{
+			break;
+		}
+		TaskPtr pTask = PopTask(nNormalCount < nNormalLimit && nNow < nNormalDeadline);
+		if (pTask == NULL)
+		{
+			break;
+		}
+		if (!pTask->IsHighPriority())
+		{
+			nNormalCount++;
+		}
+		pTask->Run();
+		nCount++;
+        DebugTask();
+	}
+	t_pConsumingScheduler = pLastScheduler;
+	//ԤʱһֱִеΪ,ͳµ
+	if (!bBudget)
+	{
+		return 0;
+	}
+	int nCarryOver = 0;
+	{
+		CSafeAdaptiveLock guard(m_queue_mutex);
+		nCarryOver = (int)(m_Tasks.size() + m_HighTasks.size());
+	}
+	m_nCarryOver.store(nCarryOver, std::memory_order_relaxed);
+	if (nCarryOver > 0)
+	{
+		m_nCarryOverTicks.fetch_add(1, std::memory_order_relaxed);
+	}
+	return nCarryOver;
+}
+
+TaskPtr CTaskScheduler::PopTask(bool bNormal)
+{
+	TaskPtr pTask;
+	{
+		CSafeAdaptiveLock guard(m_queue_mutex);
+		if (!m_HighTasks.empty())
+		{
+			pTask = m_HighTasks.front();
+			m_HighTasks.pop();
+		}
+		else if (bNormal && !m_Tasks.empty())
+		{
+			pTask = m_Tasks.front();
+			m_Tasks.pop();
+		}
+		if (m_bHighWater.load(std::memory_order_relaxed)
+			&& (m_Tasks.size() + m_HighTasks.size()) * 100 < m_nHighWaterMark * TASK_QUEUE_LOW_WATER_PERCENT)
+		{
+			m_bHighWater.store(false, std::memory_order_relaxed);
+		}
+	}
+	//ȴȵǼټ,֮һܿǼ
+	if (pTask != NULL && m_nSpaceWaiters.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_space_mutex);
+		m_space_cond.notify_one();
+	}
+	return pTask;
 }
 
-void CTaskScheduler::ConsumeTask()
+void CTaskScheduler::SetPriorityReserve(int nPercent)
 {
+	m_nPriorityReserve = MIN(MAX(nPercent, 0), TASK_PRIORITY_RESERVE_MAX);
+}
+
+void CTaskScheduler::SetQueueCapacity(size_t nCapacity, enQueueOverflow ePolicy)
+{
+	m_nQueueCapacity = nCapacity;
+	m_eOverflow = ePolicy < eQueueOverflowCount ? ePolicy : eQueueOverflowBlock;
+}
+
+void CTaskScheduler::SetHighWaterMark(size_t nMark, QueueWaterFunc func)
+{
+	m_nHighWaterMark = nMark;
+	m_funcHighWater = func;
+}
+
+void CTaskScheduler::PushTask(TaskPtr pTask)
+{
+	pTask->SetEnqueueTime(CTscClock::NowNs());
+	bool bBlocked = false;
+	TaskPtr pShedTask;
+	size_t nSize = 0;
 	while (true)
 	{
-		TaskPtr pTask;
 		{
-			CSafeLock guard(m_queue_mutex);
-			if (m_Tasks.empty())
+			CSafeAdaptiveLock guard(m_queue_mutex);
+			nSize = m_Tasks.size() + m_HighTasks.size();
+			bool bFull = m_nQueueCapacity > 0 && nSize >= m_nQueueCapacity && !pTask->IsUnbounded();
+			//ڲܶ,ͷڲʱֻʣȼһ
+			bool bShed = bFull && m_eOverflow == eQueueOverflowShed && !m_Tasks.empty() && !m_Tasks.front()->IsUnbounded();
+			if (!bFull || bShed)
 			{
+				//ͨ,гȲ
+				if (bShed)
+				{
+					pShedTask = m_Tasks.front();
+					m_Tasks.pop();
+				}
+				else
+				{
+					nSize++;
+				}
+				if (pTask->IsHighPriority())
+				{
+					m_HighTasks.push(pTask);
+				}
+				else
+				{
+					m_Tasks.push(pTask);
+				}
 				break;
 			}
-			pTask = this->m_Tasks.front();
-			this->m_Tasks.pop();
 		}
-		if (pTask != NULL)
+		if (OnQueueFull(pTask, bBlocked))
 		{
-			pTask->Run();
+			return;
 		}
-        DebugTask();
 	}
+	if (pShedTask != NULL)
+	{
+		m_nOverflowCount[eQueueOverflowShed].fetch_add(1, std::memory_order_relaxed);
+		pShedTask->Reject();
+	}
+	CheckHighWater(nSize);
 }
 
-void CTaskScheduler::PushTask(TaskPtr pTask)
+bool CTaskScheduler::OnQueueFull(TaskPtr pTask, bool& bBlocked)
+{
+	switch (m_eOverflow)
+	{
+	case eQueueOverflowBlock:
+		if (t_pConsumingScheduler != this)
+		{
+			if (!bBlocked)
+			{
+				bBlocked = true;
+				m_nOverflowCount[eQueueOverflowBlock].fetch_add(1, std::memory_order_relaxed);
+			}
+			WaitForSpace();
+			return false;
+		}
+		//̵ִ߳Լ,ֱִ
+		m_nOverflowCount[eQueueOverflowCallerRuns].fetch_add(1, std::memory_order_relaxed);
+		pTask->Run();
+		return true;
+	case eQueueOverflowCallerRuns:
+		m_nOverflowCount[eQueueOverflowCallerRuns].fetch_add(1, std::memory_order_relaxed);
+		pTask->Run();
+		return true;
+	case eQueueOverflowShed:
+		//ֻʣȼ(߶ͷڲ),ҪǸ
+		m_nOverflowCount[eQueueOverflowShed].fetch_add(1, std::memory_order_relaxed);
+		pTask->Reject();
+		return true;
+	default:
+		m_nOverflowCount[eQueueOverflowReject].fetch_add(1, std::memory_order_relaxed);
+		pTask->Reject();
+		return true;
+	}
+}
+
+void CTaskScheduler::WaitForSpace()
+{
+	std::unique_lock<std::mutex> lock(m_space_mutex);
+	m_nSpaceWaiters.fetch_add(1);
+	bool bFull = false;
+	{
+		CSafeAdaptiveLock guard(m_queue_mutex);
+		bFull = m_Tasks.size() + m_HighTasks.size() >= m_nQueueCapacity;
+	}
+	//֮ӵPopTaskҪõm_space_mutexܻ,waitͷ֮ǰᶪ
+	if (bFull)
+	{
+		m_space_cond.wait(lock);
+	}
+	m_nSpaceWaiters.fetch_sub(1);
+}
+
+size_t CTaskScheduler::GetQueueSize()
 {
-	CSafeLock guard(m_queue_mutex);
-	m_Tasks.push(pTask);
+	CSafeAdaptiveLock guard(m_queue_mutex);
+	return m_Tasks.size() + m_HighTasks.size();
+}
+
+void CTaskScheduler::CheckHighWater(size_t nSize)
+{
+	if (m_nHighWaterMark == 0 || nSize < m_nHighWaterMark || m_bHighWater.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	//Ͷʱֻһ̻߳ص
+	if (!m_bHighWater.exchange(true, std::memory_order_relaxed))
+	{
+		CACHE_LOG(THREAD_ERROR, "Scheduler[{}] task queue reach high water mark,size = {} mark = {}", m_Signature, nSize, m_nHighWaterMark);
+		if (m_funcHighWater != NULL)
+		{
+			m_funcHighWater(this, nSize);
+		}
+	}
 }
 
 void CTaskScheduler::ScheduleTask(TaskPtr pTask)
 {
-    if(pTask->GetState() != enTaskState::eTaskInit)
+    //CTask::Cancel,ѾȡͶ
+    enTaskState state = enTaskState::eTaskInit;
+    if(!pTask->m_nState.compare_exchange_strong(state, enTaskState::eTaskWaitingFoDoing, std::memory_order_acq_rel))
     {
+        if (state == enTaskState::eTaskCancelled)
+        {
+            return;
+        }
         ASSERT_EX(false,"CThreadScheduler[{}] Schedule task failed,the task[{}] has been scheduled",m_Signature,pTask->GetSignature());
         return;
     }
-    pTask->SetState(enTaskState::eTaskWaitingFoDoing);
     PushTask(pTask);
 }
 
+void CTaskScheduler::ScheduleTaskAfter(TaskPtr pTask, time_t delay)
+{
+    //ʱProcessDelayTaskļ鶼õʱ,ǽʱ䲻ʱǰƳ
+    uint64 nExpire = CTimeHelper::GetSingletonPtr()->GetMSTime(true) + delay;
+    CSafeLock guard(m_delay_mutex);
+    m_DelayTasks.insert(std::make_pair(nExpire, pTask));
+    m_nDelayTaskCount.fetch_add(1, std::memory_order_release);
+}
+
+bool CTaskScheduler::CancelTaskAfter(TaskPtr pTask)
+{
+    //Ѿ(AcceptAnyʤ)ȡ,ҲҪƳ
+    pTask->Cancel();
+    if (pTask->GetState() != enTaskState::eTaskCancelled)
+    {
+        return false;
+    }
+    //ʱһ㰴Ͷ˳,Ͷݵĩβ,Ӻǰ
+    CSafeLock guard(m_delay_mutex);
+    for (std::multimap<uint64, TaskPtr>::reverse_iterator iter = m_DelayTasks.rbegin(); iter != m_DelayTasks.rend(); ++iter)
+    {
+        if (iter->second == pTask)
+        {
+            m_DelayTasks.erase(std::next(iter).base());
+            m_nDelayTaskCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CTaskScheduler::ProcessDelayTask()
+{
+    if (m_nDelayTaskCount.load(std::memory_order_acquire) == 0)
+    {
+        return;
+    }
+    std::vector<TaskPtr> expireList;
+    {
+        uint64 nNow = CTimeHelper::GetSingletonPtr()->GetMSTime();
+        CSafeLock guard(m_delay_mutex);
+        while (!m_DelayTasks.empty() && m_DelayTasks.begin()->first <= nNow)
+        {
+            expireList.push_back(m_DelayTasks.begin()->second);
+            m_DelayTasks.erase(m_DelayTasks.begin());
+            m_nDelayTaskCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    for (size_t index = 0; index < expireList.size(); ++index)
+    {
+        ScheduleTask(expireList[index]);
+    }
+}
+
 
 void CTaskScheduler::DebugTask()
 {
-	time_t nNow = CTimeHelper::GetSingletonPtr()->GetMSTime();
-	if (debug_timer.IsTimeout(nNow))
+	if (debug_timer.IsTimeout())
 	{
 		int nSize = 0;
 		{
-			CSafeLock guard(m_queue_mutex);
-			nSize = m_Tasks.size();
+			CSafeAdaptiveLock guard(m_queue_mutex);
+			nSize = m_Tasks.size() + m_HighTasks.size();
 		}
 		//CACHE_LOG(THREAD_CACHE, "=========================Begin===============================");
-		CACHE_LOG(DEBUG_CACHE, "Scheduler[{}] : Thread task queuesize = {}",m_Signature,nSize);
+		CACHE_LOG(DEBUG_CACHE, "Scheduler[{}] : Thread task queuesize = {} carry over ticks = {}",m_Signature,nSize,GetCarryOverTicks());
 		//CACHE_LOG(THREAD_CACHE, "=========================End================================");
 	}
 }
\ No newline at end of file
@@ -13,6 +13,11 @@
 #include <thread>
 #include <functional>
 #include <list>
+#include <map>
+#include <utility>
+#include <climits>
+#include <mutex>
+#include <condition_variable>
 #include "safe_pointer.h"
 #include "task.h"
 #include "task_helper.h"
@@ -20,6 +25,79 @@
 #include "my_lock.h"
 
 #define THREAD_TASK_DEBUG_TIME (20 *1000)   //еʱ
+#define TASK_PRIORITY_RESERVE_MAX (100)     //֡ԤԤ(ٷֱ)
+#define TASK_QUEUE_LOW_WATER_PERCENT (50)   //нˮλٷֱ,ˮλصŻٴδ
+
+//ʱĴ
+enum enQueueOverflow
+{
+	eQueueOverflowBlock = 0,		//Ͷ߳˯ߵȴпճλ,ڱִ߳ͶʱΪͶִ߳
+	eQueueOverflowReject = 1,		//ֱӰʧܴ(OnFailed),յʧ
+	eQueueOverflowCallerRuns = 2,	//Ͷֱִ߳
+	eQueueOverflowShed = 3,			//ͨ(ʧܴ)ڳλ,ֻʣȼʱʧܴ
+	eQueueOverflowCount,
+};
+
+class CTaskScheduler;
+//гȵˮλʱͶ߳ϻص,Ϊ͵ǰг
+typedef std::function<void(CTaskScheduler*, size_t)> QueueWaterFunc;
+
+//Hedgedͳ
+class CHedgeStat : public CSingleton<CHedgeStat>
+{
+public:
+	CHedgeStat()
+	{
+		m_nTotal.store(0);
+		m_nFired.store(0);
+		m_nWon.store(0);
+	}
+	void Report()
+	{
+		CACHE_LOG(DEBUG_CACHE, "Hedged total = {} fired = {} won = {}", m_nTotal.load(), m_nFired.load(), m_nWon.load());
+	}
+public:
+	std::atomic<uint64>		m_nTotal;	//Hedged
+	std::atomic<uint64>		m_nFired;	//ʼִеĴ
+	std::atomic<uint64>		m_nWon;		//׸ɵĴ
+};
+
+//HedgedִеĽ,ǷԱ;fvoidʱֻʣ
+template<typename R>
+struct CHedgeAttempt
+{
+	typedef std::pair<bool, R> ResultType;
+	static ResultType Run(const std::function<R()>& func, bool bBackup)
+	{
+		return ResultType(bBackup, func());
+	}
+	static bool IsBackup(const ResultType& res)
+	{
+		return res.first;
+	}
+	static R Unwrap(ResultType& res)
+	{
+		return std::move(res.second);
+	}
+};
+
+template<>
+struct CHedgeAttempt<void>
+{
+	typedef bool ResultType;
+	static ResultType Run(const std::function<void()>& func, bool bBackup)
+	{
+		func();
+		return bBackup;
+	}
+	static bool IsBackup(ResultType res)
+	{
+		return res;
+	}
+	static void Unwrap(ResultType&)
+	{
+	}
+};
 
 class CTaskScheduler
 {
@@ -29,10 +107,40 @@ public:
 	virtual ~CTaskScheduler();
 	//
     virtual void ScheduleTask(TaskPtr pTask);
-	//ִ
-    void ConsumeTask();
+	//ʱ,delayͶݵ,ǰȡֱӶ
+	virtual void ScheduleTaskAfter(TaskPtr pTask, time_t delay);
+	/**
+	 * ȡûڵʱ񲢴ʱƳ,õȵڲͷ;ǷƳ,ѾͶݻִ˷false
+	 * ֻұʱ,CStrandSchedulerʱ̳߳,ȡתԱ
+	 */
+	bool CancelTaskAfter(TaskPtr pTask);
+	//ûڵʱ
+	int  GetDelayTaskCount() const { return m_nDelayTaskCount.load(std::memory_order_acquire); }
+	/**
+	 * ִ,ȼִ;nMaxTasks/nMaxMicrosΪһִ֡е΢,0ʾ,
+	 * Ԥͣ,ʣµһ֡,µ
+	 * ԤʱֻͨԤ(100-Ԥ)%,ʣµֻȼ,ʱ֡Ҳܰʱ
+	 */
+    int  ConsumeTask(int nMaxTasks = 0, uint64 nMaxMicros = 0);
+	//֡ԤΪȼԤİٷֱ
+	void SetPriorityReserve(int nPercent);
+	//һ֡µ
+	int  GetCarryOver()		{ return m_nCarryOver.load(std::memory_order_relaxed); }
+	//Ԥ껹֡
+	uint64 GetCarryOverTicks()	{ return m_nCarryOverTicks.load(std::memory_order_relaxed); }
+	/**
+	 * (ͨ͸ȼһ),0ʾ;ʱePolicy,ǰ
+	 * ʱںͶݶPushTask,ͬ;ScheduleUnboundedͶݵڲ
+	 */
+	void SetQueueCapacity(size_t nCapacity, enQueueOverflow ePolicy = eQueueOverflowBlock);
+	//гȵnMarkʱصһ,nMarkTASK_QUEUE_LOW_WATER_PERCENT%ºЧ,ǰ
+	void SetHighWaterMark(size_t nMark, QueueWaterFunc func);
+	//ǰŶӵ(ͨ͸ȼ)
+	size_t GetQueueSize();
+	//ЧĴ,eQueueOverflowBlockͶݴ,ǵȴĴ
+	uint64 GetOverflowCount(enQueueOverflow ePolicy)	{ return ePolicy < eQueueOverflowCount ? m_nOverflowCount[ePolicy].load(std::memory_order_relaxed) : 0; }
 	//
-    void PushTask(TaskPtr pTask);
+    virtual void PushTask(TaskPtr pTask);
 	//
 	void DebugTask();
 public:
@@ -44,6 +152,29 @@ public:
 		return CTaskHelper<return_type>(pTask);
 	}
 
+	//ȼ,ȼ
+	template<class Func, typename return_type = typename std::result_of<Func()>::type>
+	CTaskHelper<return_type> SchedulePriority(std::string signature, Func&& f)
+	{
+		TaskPtr pTask = TaskCreater<return_type, void, Func>::CreateTask(this, signature, std::forward<Func>(f));
+		pTask->SetHighPriority(true);
+		ScheduleTask(pTask);
+		return CTaskHelper<return_type>(pTask);
+	}
+
+	/**
+	 * ڲ(strandִΡ),ʱҲֱ,Shedᶪ
+	 * 񱻾ܾstrand߲ԶȲ,ڹֱִֻ߳ݹ
+	 */
+	template<class Func, typename return_type = typename std::result_of<Func()>::type>
+	CTaskHelper<return_type> ScheduleUnbounded(std::string signature, Func&& f)
+	{
+		TaskPtr pTask = TaskCreater<return_type, void, Func>::CreateTask(this, signature, std::forward<Func>(f));
+		pTask->SetUnbounded(true);
+		ScheduleTask(pTask);
+		return CTaskHelper<return_type>(pTask);
+	}
+
 	template<class Func, typename return_type = typename std::result_of<Func()>::type>
 	static CTaskHelper<return_type> Schedule(CSafePtr<CTaskScheduler> pScheduler, std::string signature, Func&& f)
 	{
@@ -81,7 +212,6 @@ public:
     static CAcceptCombineTaskHelper<typename TaskHelpers::ReturnType...> AcceptAllCombine(TaskHelpers&... tasks) 
 	{
         std::vector<TaskPtr> taskList = {tasks.GetTask()...};
-		CombineArgs<0,typename TaskHelpers::ReturnType...>(tasks...);
         return CAcceptCombineTaskHelper<typename TaskHelpers::ReturnType...>(taskList);
 	}
 
@@ -89,10 +219,122 @@ public:
     static CAcceptCombineTaskHelper<typename TaskHelpers::ReturnType...> AcceptAnyCombine(TaskHelpers&... tasks) 
 	{
         std::vector<TaskPtr> taskList = {tasks.GetTask()...};
-		CombineArgs<0,typename TaskHelpers::ReturnType...>(tasks...);
         return CAcceptCombineTaskHelper<typename TaskHelpers::ReturnType...>(taskList);
 	}
 
+	/**
+	 * ݵԳ:schedulers[0]ִf,delay(һȡp95ӳ)ûschedulers[1]ִһ
+	 * ִͨAcceptAny,ɵʤ,һŶ(û)Ļᱻȡ,ͳƽCHedgeStat
+	 * ׸ʤʱͬʱʱƳ,ȵdelayͷ
+	 */
+	template<class Scheduler, class Func, typename return_type = typename std::result_of<Func()>::type>
+	static CTaskHelper<return_type> Hedged(Func&& f, std::vector<CSafePtr<Scheduler>> schedulers, time_t delay)
+	{
+		typedef CHedgeAttempt<return_type> Attempt;
+		typedef typename Attempt::ResultType AttemptResult;
+		ASSERT_EX(!schedulers.empty(), "Hedged schedulers is empty");
+		CSafePtr<CTaskScheduler> pPrimary = schedulers[0].Get();
+		CSafePtr<CTaskScheduler> pBackup = schedulers[schedulers.size() > 1 ? 1 : 0].Get();
+		std::function<return_type()> func = std::forward<Func>(f);
+		CHedgeStat::GetSingletonPtr()->m_nTotal++;
+
+		CTaskHelper<AttemptResult> primary = pPrimary->Schedule("Hedged_Primary",
+			[func]()
+			{
+				return Attempt::Run(func, false);
+			});
+		TaskPtr pBackupTask = TaskCreater<AttemptResult, void, std::function<AttemptResult()>>::CreateTask(pBackup, "Hedged_Backup",
+			[func]()
+			{
+				CHedgeStat::GetSingletonPtr()->m_nFired++;
+				return Attempt::Run(func, true);
+			});
+		CTaskHelper<AttemptResult> backup(pBackupTask);
+		WeakTaskPtr pBackupWeak = pBackupTask;
+		CTaskHelper<return_type> helper = AcceptAnyCombine(primary, backup).AcceptAny(pPrimary,
+			[pBackup, pBackupWeak](AttemptResult res) -> return_type
+			{
+				if (Attempt::IsBackup(res))
+				{
+					CHedgeStat::GetSingletonPtr()->m_nWon++;
+				}
+				else
+				{
+					//û,ֱӴʱõ
+					TaskPtr pBackupTask = pBackupWeak.lock();
+					if (pBackupTask != NULL)
+					{
+						pBackup->CancelTaskAfter(pBackupTask);
+					}
+				}
+				return Attempt::Unwrap(res);
+			});
+		//ʱ,֤׸ʤʱһܱȡ
+		pBackup->ScheduleTaskAfter(pBackupTask, delay);
+		return helper;
+	}
+
+	/**
+	 * ʱ,ǰɺ󷵻ذ±еĽ,һǰʧ򷵻صʧ
+	 * ÿǰԼ߳ϰѽдԤĲλ,һɵǰֱִк
+	 */
+	template<typename T>
+	static CTaskHelper<std::vector<T>> WhenAll(std::vector<CTaskHelper<T>> tasks)
+	{
+		std::shared_ptr<CWhenAllContext<T>> pContext = std::make_shared<CWhenAllContext<T>>(tasks.size());
+		CSafePtr<CTaskScheduler> pScheduler;
+		std::string signature = "WhenAll";
+		if (!tasks.empty())
+		{
+			pScheduler = tasks[0].GetTask()->GetScheduler();
+			signature = tasks[0].GetTask()->GetSignature() + "_WhenAll";
+		}
+		pContext->m_pDoneTask = TaskCreater<std::vector<T>, void, std::function<std::vector<T>()>>::CreateTask(pScheduler, signature,
+			[pContext]()
+			{
+				if (pContext->m_bFailed.load(std::memory_order_relaxed))
+				{
+					throw std::runtime_error("WhenAll parent task failed");
+				}
+				return std::move(pContext->m_Results);
+			});
+		CTaskHelper<std::vector<T>> helper(pContext->m_pDoneTask);
+		AttachFanInSlots<T>(tasks, pScheduler, pContext);
+		return helper;
+	}
+
+	/**
+	 * ʱĹԼ,Ϊinitǰͨopϲֵ
+	 * ǰĽʱ۵ǰ̵߳Ĳֽ,ϲֽ,ڴռǰ޹
+	 * opɺͽ,ϲ˳ȷ
+	 */
+	template<typename T, class Op>
+	static CTaskHelper<T> WhenAllReduce(std::vector<CTaskHelper<T>> tasks, T init, Op&& op)
+	{
+		typedef CWhenAllReduceContext<T, typename std::decay<Op>::type> ContextType;
+		//ÿ̵߳Ĳֽж,make_sharedc++17֮ǰ֤
+		std::shared_ptr<ContextType> pContext = std::allocate_shared<ContextType>(CCacheLineAllocator<ContextType>(), tasks.size(), init, std::forward<Op>(op));
+		CSafePtr<CTaskScheduler> pScheduler;
+		std::string signature = "WhenAllReduce";
+		if (!tasks.empty())
+		{
+			pScheduler = tasks[0].GetTask()->GetScheduler();
+			signature = tasks[0].GetTask()->GetSignature() + "_WhenAllReduce";
+		}
+		pContext->m_pDoneTask = TaskCreater<T, void, std::function<T()>>::CreateTask(pScheduler, signature,
+			[pContext]()
+			{
+				if (pContext->m_bFailed.load(std::memory_order_relaxed))
+				{
+					throw std::runtime_error("WhenAllReduce parent task failed");
+				}
+				return pContext->Merge();
+			});
+		CTaskHelper<T> helper(pContext->m_pDoneTask);
+		AttachFanInSlots<T>(tasks, pScheduler, pContext);
+		return helper;
+	}
+
 	// // 2. ʵģ壨չ
 	// template<typename... TaskHelpers, size_t... Indices>
 	// static CAcceptCombineTaskHelper<typename TaskHelpers::ReturnType...> AcceptCombineImpl(TaskHelpers&... tasks, std::index_sequence<Indices...>) 
@@ -109,31 +351,61 @@ public:
 
 	void Join(); 
 private:
-	template<int N,typename ...Args>
-    static void CombineArgs()
-    {
-        return;
-    }
-    template<int N,typename ...Args,typename T>
-    static void CombineArgs(T&& t)
-    {
-		CArgsTypeList<N,Args...>* argsHolder = new CArgsTypeList<N,Args...>();
-  		t.GetTask()->SetAcceptCombineInfo(argsHolder);
-    }
-
-    template<int N,typename ...Args,typename First, typename... Rest>
-    static void CombineArgs(First&& first, Rest&&...rest)
-    {
-		CArgsTypeList<N,Args...>* argsHolder = new CArgsTypeList<N,Args...>();
-		first.GetTask()->SetAcceptCombineInfo(argsHolder);
-        CombineArgs<N+1,Args...>(std::forward<Rest>(rest)...);
-    }
-	
+	//ÿǰһλ,ûǰʱֱͷŽ
+	template<typename T, class Context>
+	static void AttachFanInSlots(std::vector<CTaskHelper<T>>& tasks, CSafePtr<CTaskScheduler> pScheduler, std::shared_ptr<Context> pContext)
+	{
+		if (tasks.empty())
+		{
+			pContext->Release();
+			return;
+		}
+
+		for (size_t index = 0; index < tasks.size(); ++index)
+		{
+			TaskPtr pParentTask = tasks[index].GetTask();
+			TaskPtr pSlotTask = std::make_shared<CFanInSlotTask<T, Context>>(pScheduler, pContext, index);
+			pParentTask->AddChildTask(pSlotTask);
+			//пӵ֮ǰǰѾˣûִУٴγִ
+			if (pParentTask->IsFinished())
+			{
+				pParentTask->RunChildTask();
+			}
+		}
+	}
+
+protected:
+	//ѵڵʱͶݵ
+	void ProcessDelayTask();
+	//ȡһ,ȼ,bNormalΪfalseʱֻȡȼ
+	TaskPtr PopTask(bool bNormal);
+	//ʱԴ,trueʾѾ,
+	bool OnQueueFull(TaskPtr pTask, bool& bBlocked);
+	//֮ˮλ
+	void CheckHighWater(size_t nSize);
+	//ʱ˯,ֱPopTaskȡ
+	void WaitForSpace();
 protected:
 	std::queue<TaskPtr> m_Tasks;
-	CMyLock		        m_queue_mutex;
+	std::queue<TaskPtr> m_HighTasks;	//ȼ,m_Tasksһm_queue_mutex
+	CAdaptiveLock		m_queue_mutex;
+	std::multimap<uint64, TaskPtr>	m_DelayTasks;		//ʱ() -> ʱ
+	std::atomic_int		m_nDelayTaskCount;
+	CMyLock				m_delay_mutex;
 	std::string         m_Signature;	//ǩ
 	CMyTimer			debug_timer;	//߳debug timer
+	int					m_nPriorityReserve;	//ǰ
+	std::atomic_int		m_nCarryOver;		//Ԥִе߳д,̶֡ʵ̳߳ػж߳һд
+	std::atomic<uint64>	m_nCarryOverTicks;
+	size_t				m_nQueueCapacity;	//ǰ
+	enQueueOverflow		m_eOverflow;
+	size_t				m_nHighWaterMark;
+	QueueWaterFunc		m_funcHighWater;
+	std::atomic_bool	m_bHighWater;		//Ѿˮλ,û
+	std::atomic<uint64>	m_nOverflowCount[eQueueOverflowCount];
+	std::mutex			m_space_mutex;		//ֻm_space_cond,бm_queue_mutex
+	std::condition_variable	m_space_cond;
+	std::atomic_int		m_nSpaceWaiters;	//ȴλͶ߳,Ϊ0ʱPopTaskû
 	bool 				stop;
 };
 
@@ -1,7 +1,11 @@
+#include <thread>
 #include "task_thread.h"
+#include "rcu.h"
 
 CTaskThread::CTaskThread(CSafePtr<CTaskScheduler> scheduler)
-	: m_pScheduler(scheduler)
+	: m_pScheduler(scheduler),
+	m_nTickRate(0),
+	m_eCatchUp(eTickCatchUpSkip)
 {
 
 }
@@ -11,24 +15,142 @@ CTaskThread::~CTaskThread()
 
 bool CTaskThread::PrepareToRun()
 {
+	CRcu::GetSingletonPtr()->RegisterThread();
 	m_funcInit();
 	return true;
 }
 
 bool CTaskThread::PrepareEnd()
 {
+	if (m_nTickRate > 0)
+	{
+		CTickStat stat = m_TickStat.Read();
+		CACHE_LOG(DEBUG_CACHE, "TaskThread tick rate = {} frames = {} overruns = {} skipped = {} catch up = {} avg jitter = {} ns max jitter = {} ns max overrun = {} ns",
+			m_nTickRate, stat.m_nFrames, stat.m_nOverruns, stat.m_nSkippedFrames, stat.m_nCatchUpFrames,
+			stat.m_nJitterSamples > 0 ? stat.m_nTotalJitterNs / stat.m_nJitterSamples : 0, stat.m_nMaxJitterNs, stat.m_nMaxOverrunNs);
+	}
+	CRcu::GetSingletonPtr()->UnregisterThread();
 	return true;
 }
 
+void CTaskThread::SetTickRate(int nHz, enTickCatchUp eCatchUp)
+{
+	m_nTickRate = MAX(nHz, 0);
+	m_eCatchUp = eCatchUp;
+}
+
 void CTaskThread::Run()
 {
+	if (m_nTickRate > 0)
+	{
+		RunFixedRate();
+		return;
+	}
 	while (!IsStoped())
 	{
-		//̵߳Ļʱ
+		//»ʱ,ʱӷʱʱ߳ͳһ
 		CTimeHelper::GetSingletonPtr()->SetTime();
 		m_funcTick();
 		m_pScheduler->ConsumeTask();
-		//
-		SLEEP(1);
+		//һִ,ٳRCUָ
+		CRcu::GetSingletonPtr()->Quiescent();
+		std::this_thread::sleep_for(std::chrono::milliseconds(TASK_THREAD_IDLE_SLEEP));
+	}
+}
+
+void CTaskThread::ConsumeTask(uint64 nMaxMicros)
+{
+	//ConsumeTaskԤΪ0ʾ,ٸ1΢
+	m_pScheduler->ConsumeTask(0, MAX(nMaxMicros, (uint64)1));
+	CRcu::GetSingletonPtr()->Quiescent();
+}
+
+void CTaskThread::RunSlack(uint64 nDeadlineNs)
+{
+	while (!IsStoped())
+	{
+		uint64 nNow = CTscClock::MonotonicNs();
+		if (nNow + CLOCK_SLEEP_SPIN_NS >= nDeadlineNs)
+		{
+			break;
+		}
+		uint64 nSlackEnd = nDeadlineNs - CLOCK_SLEEP_SPIN_NS;
+		if (m_pScheduler->ConsumeTask(0, MAX((nSlackEnd - nNow) / 1000, (uint64)1)) == 0)
+		{
+			CRcu::GetSingletonPtr()->Quiescent();
+			//п,˯һСٿû,Ҫ˯֡ʼ
+			CTscClock::SleepUntilNs(MIN(nNow + TASK_THREAD_IDLE_SLEEP * 1000000ULL, nSlackEnd), 0);
+		}
+		else
+		{
+			CRcu::GetSingletonPtr()->Quiescent();
+		}
+	}
+	CTscClock::SleepUntilNs(nDeadlineNs);
+}
+
+void CTaskThread::RunFixedRate()
+{
+	uint64 nPeriod = 1000000000ULL / m_nTickRate;
+	CTickStat stat;
+	memset(&stat, 0, sizeof(stat));
+	uint64 nFrameTime = CTscClock::MonotonicNs();	//֡ƻʼʱ
+	bool bOnTime = false;							//֡ǲ˯ƻʱſʼ
+	int nCatchUp = 0;
+	while (!IsStoped())
+	{
+		uint64 nStart = CTscClock::MonotonicNs();
+		if (bOnTime)
+		{
+			uint64 nJitter = nStart > nFrameTime ? nStart - nFrameTime : 0;
+			stat.m_nJitterSamples++;
+			stat.m_nTotalJitterNs += nJitter;
+			stat.m_nMaxJitterNs = MAX(stat.m_nMaxJitterNs, nJitter);
+		}
+		CTimeHelper::GetSingletonPtr()->SetTime();
+		m_funcTick();
+		stat.m_nFrames++;
+		uint64 nNext = nFrameTime + nPeriod;
+		uint64 nNow = CTscClock::MonotonicNs();
+		if (nNow < nNext)
+		{
+			//֡߼ִ,ʣµʱִ
+			RunSlack(nNext);
+			nFrameTime = nNext;
+			bOnTime = true;
+			nCatchUp = 0;
+			m_TickStat.Write(stat);
+			continue;
+		}
+		//֡߼Ѿʱ,Ҳһʱ
+		ConsumeTask(nPeriod * TASK_TICK_OVERRUN_PERCENT / 100 / 1000);
+		nNow = CTscClock::MonotonicNs();
+		stat.m_nOverruns++;
+		stat.m_nMaxOverrunNs = MAX(stat.m_nMaxOverrunNs, nNow - nNext);
+		CACHE_LOG_LIMIT(THREAD_ERROR, TASK_TICK_OVERRUN_LOG_RATE, "TaskThread tick overrun {} ns, tick rate = {} overruns = {}",
+			nNow - nNext, m_nTickRate, stat.m_nOverruns);
+		bOnTime = false;
+		if (m_eCatchUp == eTickCatchUpBurst && nCatchUp < TASK_TICK_MAX_CATCH_UP)
+		{
+			//˯,ϲܴ֡
+			nCatchUp++;
+			stat.m_nCatchUpFrames++;
+			nFrameTime = nNext;
+		}
+		else if (m_eCatchUp == eTickCatchUpReset)
+		{
+			nFrameTime = nNow;
+		}
+		else
+		{
+			//뵽ǰʱ֮һ߽֡,м֡
+			uint64 nMissed = (nNow - nNext) / nPeriod + 1;
+			stat.m_nSkippedFrames += nMissed;
+			nFrameTime = nNext + nMissed * nPeriod;
+			nCatchUp = 0;
+			RunSlack(nFrameTime);
+			bOnTime = true;
+		}
+		m_TickStat.Write(stat);
 	}
 }
\ No newline at end of file
@@ -2,6 +2,33 @@
 #define TASK_THREAD_H
 #include "my_thread.h"
 #include "task_scheduler.h"
+#include "seq_lock.h"
+
+#define TASK_THREAD_IDLE_SLEEP		(1)		//ÿ֮֡϶Ϊʱ˯ߵʱ()
+#define TASK_TICK_MAX_CATCH_UP		(5)		//eTickCatchUpBurstܵ֡,eTickCatchUpSkip
+#define TASK_TICK_OVERRUN_PERCENT	(25)	//ʱ֡еʱ,ռ֡İٷֱ,
+#define TASK_TICK_OVERRUN_LOG_RATE	(1)		//ʱ־ÿ
+
+//֡ʱ֮׷֡
+enum enTickCatchUp
+{
+	eTickCatchUpSkip = 0,	//Ѿ֡,ȵһ߽֡,֡ʱ᲻
+	eTickCatchUpBurst = 1,	//˯ܴ֡,TASK_TICK_MAX_CATCH_UP֡
+	eTickCatchUpReset = 2,	//ӵǰʱ¼ʱ,֮֡
+};
+
+//̶֡ʵͳ,ʱ䶼
+struct CTickStat
+{
+	uint64	m_nFrames;			//ִе֡
+	uint64	m_nOverruns;		//֡߼񳬹֡֡
+	uint64	m_nSkippedFrames;	//eTickCatchUpSkip֡
+	uint64	m_nCatchUpFrames;	//eTickCatchUpBurstܵ֡
+	uint64	m_nJitterSamples;	//ʱ˯֡ʼ֡,ֻЩ֡ͳƶ
+	uint64	m_nTotalJitterNs;	//֡ʵʿʼʱȼƻʱ֮
+	uint64	m_nMaxJitterNs;
+	uint64	m_nMaxOverrunNs;	//ֹ֡ʱһ
+};
 
 class CTaskThread : public CMyThread
 {
@@ -11,8 +38,24 @@ public:
 	virtual bool PrepareToRun();
 	virtual bool PrepareEnd();
 	virtual void Run();
+	/**
+	 * ̶֡,nHzΪ0ʱÿtickִ֮˯TASK_THREAD_IDLE_SLEEP
+	 * ʱ˯֡ʼ(CTscClock::SleepUntilNs),֮֡Ŀʱִ,߳ǰ
+	 */
+	void SetTickRate(int nHz, enTickCatchUp eCatchUp = eTickCatchUpSkip);
+	int  GetTickRate()			{ return m_nTickRate; }
+	//߳̿ʱȡ
+	CTickStat GetTickStat()		{ return m_TickStat.Read(); }
+private:
+	void RunFixedRate();
+	//ֱִnDeadlineNs,Ϊʱ˯һСٿ,ȷ˯nDeadlineNs
+	void RunSlack(uint64 nDeadlineNs);
+	void ConsumeTask(uint64 nMaxMicros);
 private:
 	CSafePtr<CTaskScheduler>	m_pScheduler;
+	int							m_nTickRate;
+	enTickCatchUp				m_eCatchUp;
+	CSeqLock<CTickStat>			m_TickStat;
 };
 
 #endif
\ No newline at end of file
@@ -1,8 +1,12 @@
 #include "thread_scheduler.h"
 #include "task_thread.h"
+#include "clock_thread.h"
+#include "log_thread.h"
 
 CThreadScheduler::CThreadScheduler(std::string signature)
-	:CTaskScheduler(signature)
+	:CTaskScheduler(signature),
+	m_nTickRate(0),
+	m_eCatchUp(eTickCatchUpSkip)
 {}
 
 CThreadScheduler::~CThreadScheduler()
@@ -23,6 +27,10 @@ bool CThreadScheduler::Init(size_t threads,
 							void**		    initFuncArgs,
 							void**		    tickFuncArgs)
 {
+	//̵߳Ļʱͳһʱӷ
+	CClockThread::GetSingletonPtr()->StartClock();
+	//־ĸʽͳһ־߳
+	CLogThread::GetSingletonPtr()->StartLog();
 	for (size_t i = 0; i < threads; ++i)
 	{
 		CSafePtr<CTaskThread> pTaskThread = new CTaskThread(dynamic_cast<CTaskScheduler*>(this));
@@ -46,12 +54,30 @@ bool CThreadScheduler::Init(size_t threads,
 		}
 		tickFuncWrapper.func = tickFunc;
 		pTaskThread->SetThreadTickFunc(tickFuncWrapper);
+		pTaskThread->SetTickRate(m_nTickRate, m_eCatchUp);
 		pTaskThread->CreateThread();
 		m_Workers.emplace_back(pTaskThread.DynamicCastTo<CMyThread>());
 	}
 	return true;
 }
 
+void CThreadScheduler::SetTickRate(int nHz, enTickCatchUp eCatchUp)
+{
+	m_nTickRate = nHz;
+	m_eCatchUp = eCatchUp;
+}
+
+CTickStat CThreadScheduler::GetTickStat(size_t index)
+{
+	CTickStat stat;
+	memset(&stat, 0, sizeof(stat));
+	if (index < m_Workers.size())
+	{
+		stat = m_Workers[index].DynamicCastTo<CTaskThread>()->GetTickStat();
+	}
+	return stat;
+}
+
 void CThreadScheduler::StopScheduler()
 {
 	for (size_t i = 0; i < m_Workers.size(); ++i)
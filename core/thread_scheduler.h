@@ -17,7 +17,87 @@
 #include "time_helper.h"
 #include "my_thread.h"
 #include "my_lock.h"
+#include "spin_lock.h"
 #include "task_scheduler.h"
+#include "task_thread.h"
+
+#define PARALLEL_SPLIT_FACTOR 4     //Զʱÿ߳ƽֵ
+
+//ҿ±[nBegin,nEnd)
+struct CIndexRange
+{
+	size_t nBegin;
+	size_t nEnd;
+	CIndexRange(size_t begin, size_t end) : nBegin(begin), nEnd(end) {}
+	size_t Size() const { return nEnd > nBegin ? nEnd - nBegin : 0; }
+};
+
+//ParallelFor/ParallelReduceĹ,вֳͬ
+template<class Func>
+struct CParallelForContext
+{
+	Func							m_Func;
+	size_t							m_nGrain;
+	std::string						m_Signature;
+	std::atomic<size_t>				m_nPending;		//δɵ
+	std::atomic_bool				m_bFailed;
+	TaskPtr							m_pDoneTask;	//ɺͶݵ
+
+	CParallelForContext(Func&& func, size_t grain, std::string signature)
+		: m_Func(std::forward<Func>(func)), m_nGrain(grain), m_Signature(signature)
+	{
+		m_nPending.store(1);
+		m_bFailed.store(false);
+	}
+
+	void RunRange(size_t nBegin, size_t nEnd)
+	{
+		for (size_t index = nBegin; index < nEnd; ++index)
+		{
+			m_Func(index);
+		}
+	}
+};
+
+template<typename T, class MapFunc, class CombineFunc>
+struct CParallelReduceContext
+{
+	MapFunc							m_Map;
+	CombineFunc						m_Combine;
+	T								m_Identity;
+	T								m_Result;
+	CSpinLock						m_ResultLock;
+	size_t							m_nGrain;
+	std::string						m_Signature;
+	std::atomic<size_t>				m_nPending;
+	std::atomic_bool				m_bFailed;
+	TaskPtr							m_pDoneTask;
+
+	CParallelReduceContext(T identity, MapFunc&& map, CombineFunc&& combine, size_t grain, std::string signature)
+		: m_Map(std::forward<MapFunc>(map)), 
+		m_Combine(std::forward<CombineFunc>(combine)),
+		m_Identity(identity),
+		m_Result(identity),
+		m_ResultLock("CParallelReduceContext::m_ResultLock"),
+		m_nGrain(grain),
+		m_Signature(signature)
+	{
+		m_nPending.store(1);
+		m_bFailed.store(false);
+	}
+
+	//ڱعԼ,ټϲս,combineɺͽ
+	void RunRange(size_t nBegin, size_t nEnd)
+	{
+		T local = m_Identity;
+		for (size_t index = nBegin; index < nEnd; ++index)
+		{
+			local = m_Combine(local, m_Map(index));
+		}
+		CSafeSpLock guard(m_ResultLock);
+		m_Result = m_Combine(m_Result, local);
+	}
+};
 
 class CThreadScheduler : public CTaskScheduler
 {
@@ -31,11 +111,124 @@ public:
 					void**		    tickFuncArgs = NULL);
 	//
 	int  ThreadCount() { return m_Workers.size(); }
+	//̶ִ̰߳֡tickFunc,CTaskThread::SetTickRate,Init֮ǰ
+	void SetTickRate(int nHz, enTickCatchUp eCatchUp = eTickCatchUpSkip);
+	//index̵߳֡ͳ
+	CTickStat GetTickStat(size_t index);
 public:
 	void StopScheduler();
 	void Join(); 	
+public:
+	/**
+	 * ִf(index),indexȡֵ[range.nBegin,range.nEnd),grainΪ0ʱ߳Զ
+	 * ݹ,Ұ벿Ͷݸ߳,벿ɵֲִ̼߳
+	 * ִɺ󷵻صŻִ,ԼThenApply,һ׳쳣ʧ
+	 */
+	template<class Func>
+	CTaskHelper<void> ParallelFor(CIndexRange range, size_t grain, Func&& f)
+	{
+		typedef CParallelForContext<typename std::decay<Func>::type> ContextType;
+		std::shared_ptr<ContextType> pContext = std::make_shared<ContextType>(std::forward<Func>(f), AutoGrain(range, grain), m_Signature + "_ParallelFor");
+		pContext->m_pDoneTask = TaskCreater<void, void, std::function<void()>>::CreateTask(this, pContext->m_Signature,
+			[pContext]()
+			{
+				if (pContext->m_bFailed.load())
+				{
+					throw std::runtime_error("ParallelFor range failed");
+				}
+			});
+		CTaskHelper<void> helper(pContext->m_pDoneTask);
+		RunParallelRange(this, pContext, range.nBegin, range.nEnd);
+		return helper;
+	}
+
+	/**
+	 * йԼ,Ϊidentitymap(index)ͨcombineϲֵ,grainͬParallelFor,Ϊ0ʱԶ
+	 * combineɺͽ,ȱعԼٺϲ,ϲ˳ȷ
+	 */
+	template<typename T, class MapFunc, class CombineFunc>
+	CTaskHelper<T> ParallelReduce(CIndexRange range, size_t grain, T identity, MapFunc&& map, CombineFunc&& combine)
+	{
+		typedef CParallelReduceContext<T, typename std::decay<MapFunc>::type, typename std::decay<CombineFunc>::type> ContextType;
+		std::shared_ptr<ContextType> pContext = std::make_shared<ContextType>(identity,
+			std::forward<MapFunc>(map),
+			std::forward<CombineFunc>(combine),
+			AutoGrain(range, grain),
+			m_Signature + "_ParallelReduce");
+		pContext->m_pDoneTask = TaskCreater<T, void, std::function<T()>>::CreateTask(this, pContext->m_Signature,
+			[pContext]()
+			{
+				if (pContext->m_bFailed.load())
+				{
+					throw std::runtime_error("ParallelReduce range failed");
+				}
+				return pContext->m_Result;
+			});
+		CTaskHelper<T> helper(pContext->m_pDoneTask);
+		RunParallelRange(this, pContext, range.nBegin, range.nEnd);
+		return helper;
+	}
+private:
+	//Զ:֤ÿ̴߳ԼֵPARALLEL_SPLIT_FACTOR,˸ؾͶݿ
+	size_t AutoGrain(CIndexRange range, size_t grain)
+	{
+		if (grain > 0)
+		{
+			return grain;
+		}
+		size_t nThreads = m_Workers.empty() ? 1 : m_Workers.size();
+		size_t nGrain = range.Size() / (nThreads * PARALLEL_SPLIT_FACTOR);
+		return nGrain > 0 ? nGrain : 1;
+	}
+
+	template<class Context>
+	static void RunParallelRange(CSafePtr<CThreadScheduler> pScheduler, std::shared_ptr<Context> pContext, size_t nBegin, size_t nEnd)
+	{
+		//ʱ,Ұ벿Ͷݳȥ,ǰ̼߳벿
+		while (nEnd > nBegin && nEnd - nBegin > pContext->m_nGrain)
+		{
+			size_t nMid = nBegin + (nEnd - nBegin) / 2;
+			pContext->m_nPending.fetch_add(1, std::memory_order_relaxed);
+			//鱻ܾĻδԶ0
+			pScheduler->ScheduleUnbounded(pContext->m_Signature,
+				[pScheduler, pContext, nMid, nEnd]()
+				{
+					RunParallelRange(pScheduler, pContext, nMid, nEnd);
+				});
+			nEnd = nMid;
+		}
+		if (!pContext->m_bFailed.load(std::memory_order_relaxed))
+		{
+			try
+			{
+				pContext->RunRange(nBegin, nEnd);
+			}
+			catch (std::exception& e)
+			{
+				pContext->m_bFailed.store(true);
+				CACHE_LOG_LIMIT(THREAD_ERROR, TASK_FAILED_LOG_RATE, "Task[{}] range[{},{}) caught exception,exception msg:{}", pContext->m_Signature, nBegin, nEnd, e.what());
+			}
+			catch (...)
+			{
+				//std::exception쳣ҲҪΪʧ,δ0,ԶͶ
+				pContext->m_bFailed.store(true);
+				CACHE_LOG_LIMIT(THREAD_ERROR, TASK_FAILED_LOG_RATE, "Task[{}] range[{},{}) caught unknown exception", pContext->m_Signature, nBegin, nEnd);
+			}
+		}
+		//һɵ鸺Ͷݽ,ͬʱϿ֮ѭ
+		if (pContext->m_nPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			TaskPtr pDoneTask = pContext->m_pDoneTask;
+			pContext->m_pDoneTask = NULL;
+			//鶼Ѿִ,ҲΪܾ
+			pDoneTask->SetUnbounded(true);
+			pScheduler->ScheduleTask(pDoneTask);
+		}
+	}
 private:
 	std::vector<CSafePtr<CMyThread>> m_Workers;
+	int								 m_nTickRate;
+	enTickCatchUp					 m_eCatchUp;
 	bool 							 stop;
 	//std::condition_variable condition;
 };
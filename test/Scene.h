@@ -4,6 +4,9 @@
 #include "task_helper.h"
 #include "task_scheduler.h"
 
+#define SCENE_TICK_RATE (20)                   //̵߳Ĺ̶֡(Hz)
+#define SCENE_TICK_BUDGET_MICROS (5 * 1000)   //ÿִ֡ʱԤ(΢),ʣµһ֡
+
 enum SCENE_STATE
 {
     SCENE_STATUS_NORMAL = 0,
@@ -26,7 +29,7 @@ class Scene : public CTaskScheduler
 {
 public:
     Scene() : CTaskScheduler("Scene") {};
-    void                                Tick() {ConsumeTask();}
+    void                                Tick() {ConsumeTask(0, SCENE_TICK_BUDGET_MICROS);}
     int                                 SceneID() { return 0; }
     Obj_Human*                          GetHumanObjInSceneByGUID(int guid) { return new Obj_Human(); }
 };
@@ -3,6 +3,13 @@
 
 #include "task_helper.h"
 #include "thread_scheduler.h"
+#include "strand_scheduler.h"
+#include "sharded_scheduler.h"
+#include "clock_thread.h"
+#include "log_thread.h"
+#include "file_log_sink.h"
+#include "seq_lock.h"
+#include "rcu.h"
 #include "t_array.h"
 #include "Scene.h"
 
@@ -202,6 +209,7 @@ void scene_test()
 		CSafePtr<CThreadScheduler> pScheduler = new CThreadScheduler("TestScheduler");
 		g_SceneSchedulerList[i] = pScheduler;
 		g_SceneObjList[i] = new Scene();
+		pScheduler->SetTickRate(SCENE_TICK_RATE);
 	}
 	for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
 	{
@@ -304,9 +312,1468 @@ void scene_test()
 	CACHE_LOG(DEBUG_CACHE, "scene_test done score = {}",nScore);
 }
 
+#define MAX_TEST_ENTITY 50000
+
+void parallel_test()
+{
+	if (!g_LogicScheduler->Init(4))
+	{
+		return;
+	}
+
+	std::vector<Obj_Human> humanList(MAX_TEST_ENTITY);
+	g_LogicScheduler->ParallelFor(CIndexRange(0, humanList.size()), 0,
+	[&humanList](size_t index)
+	{
+		humanList[index].AddScore();
+	}).ThenApply(g_LogicScheduler,
+	[&humanList]()
+	{
+		g_LogicScheduler->ParallelReduce(CIndexRange(0, humanList.size()), 0, 0,
+		[&humanList](size_t index)
+		{
+			return humanList[index].GetScore();
+		},
+		[](int left, int right)
+		{
+			return left + right;
+		}).ThenAccept(g_LogicScheduler,
+		[](int sum)
+		{
+			CACHE_LOG(DEBUG_CACHE, "parallel_test sum = {} expect = {}", sum, MAX_TEST_ENTITY);
+			g_LogicScheduler->StopScheduler();
+		});
+	});
+
+	g_LogicScheduler->Join();
+	CACHE_LOG(DEBUG_CACHE, "parallel_test done");
+}
+
+#define TEST_PARALLEL_THROW_GRAIN 100
+
+void parallel_throw_test()
+{
+	if (!g_LogicScheduler->Init(4))
+	{
+		return;
+	}
+
+	//׳std::exception쳣,ҲҪͶݲʧܴ
+	CTaskHelper<int> helper = g_LogicScheduler->ParallelReduce(CIndexRange(0, MAX_TEST_ENTITY), TEST_PARALLEL_THROW_GRAIN, 0,
+	[](size_t index)
+	{
+		if (index == MAX_TEST_ENTITY / 2)
+		{
+			throw index;
+		}
+		return 1;
+	},
+	[](int left, int right)
+	{
+		return left + right;
+	});
+	while (!helper.GetTask()->IsFinished())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CACHE_LOG(DEBUG_CACHE, "parallel_throw_test ok = {}", helper.GetTask()->GetState() == enTaskState::eTaskFailed);
+	g_LogicScheduler->StopScheduler();
+	g_LogicScheduler->Join();
+}
+
+void when_all_test()
+{
+	for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+	{
+		CSafePtr<CThreadScheduler> pScheduler = new CThreadScheduler("TestScheduler");
+		g_SchedulerList[i] = pScheduler;
+		g_SchedulerList[i]->Init(2);
+	}
+
+	//Ƭʱȷ
+	int nShardCount = 37 + rand() % 64;
+	std::atomic<int> count(0);
+	std::vector<CTaskHelper<int>> shardList;
+	for (int index = 0; index < nShardCount; index++)
+	{
+		shardList.push_back(test_scheduler_task(index));
+	}
+	CTaskScheduler::WhenAll(shardList).ThenAccept(RandomScheduler(),
+	[nShardCount,&count](std::vector<int> resList)
+	{
+		bool bOk = (int)resList.size() == nShardCount;
+		for (size_t index = 0; bOk && index < resList.size(); index++)
+		{
+			bOk = resList[index] == (int)index + 10;
+		}
+		CACHE_LOG(DEBUG_CACHE, "when_all_test shard = {} ok = {}", nShardCount, bOk);
+		if (++count == 2)
+		{
+			for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+			{
+				g_SchedulerList[i]->StopScheduler();
+			}
+		}
+	});
+
+	std::vector<CTaskHelper<int>> scoreList;
+	for (int index = 0; index < 1000; index++)
+	{
+		scoreList.push_back(test_scheduler_task(index));
+	}
+	CTaskScheduler::WhenAllReduce(scoreList, 0,
+	[](int left, int right)
+	{
+		return left + right;
+	}).ThenAccept(RandomScheduler(),
+	[&count](int sum)
+	{
+		//sum(index + 10), index = [0,1000)
+		CACHE_LOG(DEBUG_CACHE, "when_all_reduce_test sum = {} expect = {}", sum, 999 * 1000 / 2 + 10 * 1000);
+		if (++count == 2)
+		{
+			for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+			{
+				g_SchedulerList[i]->StopScheduler();
+			}
+		}
+	});
+
+	for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+	{
+		g_SchedulerList[i]->Join();
+	}
+	CACHE_LOG(DEBUG_CACHE, "when_all_test done");
+}
+
+void accept_any_test()
+{
+	for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+	{
+		CSafePtr<CThreadScheduler> pScheduler = new CThreadScheduler("TestScheduler");
+		g_SchedulerList[i] = pScheduler;
+		g_SchedulerList[i]->Init(2);
+	}
+
+	std::atomic<int> count(0);
+	std::vector<TaskPtr> loserList;
+	for (int index = 0; index < MAX_TEST_ANY_COUNT; index++)
+	{
+		auto task1 = test_scheduler_task(index * 10);
+		auto task2 = test_scheduler_task(index * 10);
+		auto task3 = test_scheduler_task(index * 10);
+		auto task4 = test_scheduler_task(index * 10);
+		loserList.push_back(task1.GetTask());
+		loserList.push_back(task2.GetTask());
+		loserList.push_back(task3.GetTask());
+		loserList.push_back(task4.GetTask());
+		CTaskScheduler::AcceptAnyCombine(task1,task2,task3,task4)
+			.AcceptAny(RandomScheduler(),
+			[&count,index](int value)
+			{
+				if (value != index * 10 + 10)
+				{
+					CACHE_LOG(DEBUG_CACHE, "accept_any_test index = {} value = {}",index,value);
+				}
+				if(++count == MAX_TEST_ANY_COUNT)
+				{
+					for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+					{
+						g_SchedulerList[i]->StopScheduler();
+					}
+				}
+			});
+	}
+
+	for (size_t i = 0; i < MAX_TEST_SCHEDULER; i++)
+	{
+		g_SchedulerList[i]->Join();
+	}
+
+	int nCancelled = 0;
+	for (size_t index = 0; index < loserList.size(); index++)
+	{
+		if (loserList[index]->GetState() == enTaskState::eTaskCancelled)
+		{
+			nCancelled++;
+		}
+	}
+	CACHE_LOG(DEBUG_CACHE, "accept_any_test count = {} cancelled = {}", count, nCancelled);
+}
+
+#define MAX_TEST_HEDGED_COUNT 50
+
+void hedged_test()
+{
+	g_DBScheduler->Init(2);
+	g_HttpScheduler->Init(2);
+
+	std::atomic<int> count(0);
+	std::vector<CSafePtr<CThreadScheduler>> schedulers = { g_DBScheduler, g_HttpScheduler };
+	for (int index = 0; index < MAX_TEST_HEDGED_COUNT; index++)
+	{
+		CTaskScheduler::Hedged(
+		[index]()
+		{
+			//ģżݵDB
+			int nCost = rand() % 5 == 0 ? 50 : 1;
+			std::this_thread::sleep_for(std::chrono::milliseconds(nCost));
+			return index;
+		}, schedulers, 10).ThenAccept(g_LogicScheduler,
+		[&count,index](int value)
+		{
+			if (value != index)
+			{
+				CACHE_LOG(DEBUG_CACHE, "hedged_test index = {} value = {}", index, value);
+			}
+			if (++count == MAX_TEST_HEDGED_COUNT)
+			{
+				g_DBScheduler->StopScheduler();
+				g_HttpScheduler->StopScheduler();
+				g_LogicScheduler->StopScheduler();
+			}
+		});
+	}
+	g_LogicScheduler->Init(1);
+
+	g_DBScheduler->Join();
+	g_HttpScheduler->Join();
+	g_LogicScheduler->Join();
+	CHedgeStat::GetSingletonPtr()->Report();
+}
+
+//׸󶼺ܿ,ʱ㹻,ȫʱʱӦѾ
+#define TEST_HEDGED_VOID_DELAY 5000
+
+void hedged_void_test()
+{
+	g_DBScheduler->Init(2);
+	g_HttpScheduler->Init(2);
+	//׸ܿ,߳,InitǼǹ֮߳ǰִ겢StopScheduler
+	g_LogicScheduler->Init(1);
+
+	std::atomic<int> count(0);
+	std::atomic<int> runs(0);
+	std::vector<CSafePtr<CThreadScheduler>> schedulers = { g_DBScheduler, g_HttpScheduler };
+	for (int index = 0; index < MAX_TEST_HEDGED_COUNT; index++)
+	{
+		CTaskScheduler::Hedged(
+		[&runs]()
+		{
+			++runs;
+		}, schedulers, TEST_HEDGED_VOID_DELAY).ThenApply(g_LogicScheduler,
+		[&count,&runs]()
+		{
+			if (++count == MAX_TEST_HEDGED_COUNT)
+			{
+				int nDelay = g_HttpScheduler->GetDelayTaskCount();
+				CACHE_LOG(DEBUG_CACHE, "hedged_void_test runs = {} delay = {} ok = {}", runs.load(), nDelay, runs.load() == MAX_TEST_HEDGED_COUNT && nDelay == 0);
+				g_DBScheduler->StopScheduler();
+				g_HttpScheduler->StopScheduler();
+				g_LogicScheduler->StopScheduler();
+			}
+		});
+	}
+
+	g_DBScheduler->Join();
+	g_HttpScheduler->Join();
+	g_LogicScheduler->Join();
+	CHedgeStat::GetSingletonPtr()->Report();
+}
+
+#define MAX_TEST_PENDING_COUNT 100000
+
+void footprint_test()
+{
+	auto func = []() { return 1; };
+	auto accept = [](int value) { return value + 1; };
+	auto apply = [](int value) {};
+	CACHE_LOG(DEBUG_CACHE, "footprint_test sizeof(CTask) = {} cold = {} child node = {}",
+		sizeof(CTask), sizeof(CTaskColdInfo), sizeof(CChildTaskNode));
+	CACHE_LOG(DEBUG_CACHE, "footprint_test Schedule = {} ThenAccept = {} ThenApply = {} AcceptAll<2> = {} bytes per pending task",
+		PendingTaskBytes<CWithReturnTask<0, decltype(func), void>>(1),
+		PendingTaskBytes<CWithReturnTask<0, decltype(accept), int>>(1),
+		PendingTaskBytes<CNoReturnTask<0, decltype(apply), int>>(),
+		PendingTaskBytes<CWithReturnTask<2, std::function<int(int, int)>, int, int>>());
+
+	//ʵһ,ûִй,ʱͷڵ
+	std::vector<TaskPtr> pendingTasks;
+	pendingTasks.reserve(MAX_TEST_PENDING_COUNT);
+	for (int index = 0; index < MAX_TEST_PENDING_COUNT; index++)
+	{
+		CTaskHelper<int> task = g_LogicScheduler->Schedule("footprint_test", 
+		[]()
+		{
+			return 1;
+		}).ThenAccept(g_LogicScheduler, 
+		[](int value)
+		{
+			return value + 1;
+		});
+		pendingTasks.push_back(task.GetTask());
+	}
+	CACHE_LOG(DEBUG_CACHE, "footprint_test {} pending tasks about {} KB", MAX_TEST_PENDING_COUNT,
+		MAX_TEST_PENDING_COUNT * (PendingTaskBytes<CWithReturnTask<0, decltype(func), void>>(1) +
+			PendingTaskBytes<CWithReturnTask<0, decltype(accept), int>>()) / 1024);
+	g_LogicScheduler->Init(1);
+	g_LogicScheduler->StopScheduler();
+	g_LogicScheduler->Join();
+}
+
+#define MAX_TEST_SAFE_PTR_COUNT 10000000
+#define MAX_TEST_SAFE_PTR_SLOT 1024
+
+struct CSafePtrBench
+{
+	int m_nValue;
+};
+
+/**
+ * Ȱָд,ٷͨoperator->(+),ֱͳÿβƤ
+ * ڴ,޷ڱ֤־λöѼŻ
+ */
+template<class Policy>
+void safe_ptr_bench(const char* pMode, std::vector<CSafePtrBench>& objects)
+{
+	std::vector<CSafePtr<CSafePtrBench, Policy>> ptrs(MAX_TEST_SAFE_PTR_SLOT);
+	auto start = std::chrono::steady_clock::now();
+	for (int index = 0; index < MAX_TEST_SAFE_PTR_COUNT; index++)
+	{
+		ptrs[index & (MAX_TEST_SAFE_PTR_SLOT - 1)].Reset(&objects[index & (MAX_TEST_SAFE_PTR_SLOT - 1)]);
+	}
+	auto encode = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	long long nSum = 0;
+	start = std::chrono::steady_clock::now();
+	for (int index = 0; index < MAX_TEST_SAFE_PTR_COUNT; index++)
+	{
+		nSum += ptrs[index & (MAX_TEST_SAFE_PTR_SLOT - 1)]->m_nValue;
+	}
+	auto access = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	CACHE_LOG(DEBUG_CACHE, "safe_ptr_test {} encode = {} ps access = {} ps sum = {} bytes = {}", pMode,
+		encode * 1000 / MAX_TEST_SAFE_PTR_COUNT, access * 1000 / MAX_TEST_SAFE_PTR_COUNT, nSum, sizeof(CSafePtr<CSafePtrBench, Policy>));
+}
+
+void safe_ptr_test()
+{
+	std::vector<CSafePtrBench> objects(MAX_TEST_SAFE_PTR_SLOT, CSafePtrBench{ 1 });
+	safe_ptr_bench<CSafePtrRaw>("raw", objects);
+	safe_ptr_bench<CSafePtrSampled>("sampled", objects);
+	safe_ptr_bench<CSafePtrChecked>("checked", objects);
+
+	//𻵵ı־λģʽÿζܷ
+	CSafePtr<CSafePtrBench, CSafePtrChecked> badPtr(&objects[0]);
+	memset((void*)&badPtr, 0, sizeof(SPO_DATA_TYPE));
+	try
+	{
+		badPtr->m_nValue++;
+		CACHE_LOG(DEBUG_CACHE, "safe_ptr_test bad pointer not detected");
+	}
+	catch (std::exception& e)
+	{
+		CACHE_LOG(DEBUG_CACHE, "safe_ptr_test bad pointer detected");
+	}
+}
+
+#define MAX_TEST_CLOCK_COUNT 1000000
+
+void clock_test()
+{
+	CSafePtr<CTimeHelper> pTimeHelper = CTimeHelper::GetSingletonPtr();
+	CClockThread::GetSingletonPtr()->StartClock(1);
+
+	//ʱ,ʱ䲻ܵ
+	uint64 nLast = 0;
+	int nBackward = 0;
+	long long nWeekSum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int index = 0; index < MAX_TEST_CLOCK_COUNT; index++)
+	{
+		uint64 nNow = pTimeHelper->GetMSTime();
+		if (nNow < nLast)
+		{
+			nBackward++;
+		}
+		nLast = nNow;
+		nWeekSum += pTimeHelper->GetWeek();
+	}
+	auto cached = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	//ԭÿSetTime:ϵͳʱlocaltime
+	start = std::chrono::steady_clock::now();
+	for (int index = 0; index < MAX_TEST_CLOCK_COUNT; index++)
+	{
+		time_t nowTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		std::tm tm = CTimeHelper::LocalTime(nowTime);
+		nWeekSum += tm.tm_wday;
+	}
+	auto direct = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	CACHE_LOG(DEBUG_CACHE, "clock_test cached = {} ns direct = {} ns backward = {} week = {}",
+		cached / MAX_TEST_CLOCK_COUNT, direct / MAX_TEST_CLOCK_COUNT, nBackward, nWeekSum / (2 * MAX_TEST_CLOCK_COUNT));
+
+	//պlocaltimeһ(ʱһ)
+	std::tm snapshot;
+	pTimeHelper->GetCalendar(snapshot);
+	time_t nowTime = pTimeHelper->GetANSITime(true);
+	std::tm real = CTimeHelper::LocalTime(nowTime);
+	int nDiff = (real.tm_hour * 3600 + real.tm_min * 60 + real.tm_sec) - (snapshot.tm_hour * 3600 + snapshot.tm_min * 60 + snapshot.tm_sec);
+	CACHE_LOG(DEBUG_CACHE, "clock_test day = {} {} ok = {}", pTimeHelper->Time2Day(), real.tm_year + 1900,
+		snapshot.tm_yday == real.tm_yday && nDiff >= 0 && nDiff <= 1);
+	CClockThread::GetSingletonPtr()->StopClock();
+}
+
+#define MAX_TEST_TSC_COUNT 1000000
+#define MAX_TEST_TSC_TASK 100
+
+void tsc_test()
+{
+	CACHE_LOG(DEBUG_CACHE, "tsc_test tsc = {} ps per tick = {}", CTscClock::IsTscEnabled(), (long long)(CTscClock::GetNsPerTick() * 1000));
+	uint64 nSum = 0;
+	uint64 nBegin = CTscClock::MonotonicNs();
+	for (int index = 0; index < MAX_TEST_TSC_COUNT; index++)
+	{
+		nSum += CTscClock::NowNs() & 1;
+	}
+	uint64 nTsc = CTscClock::MonotonicNs() - nBegin;
+	nBegin = CTscClock::MonotonicNs();
+	for (int index = 0; index < MAX_TEST_TSC_COUNT; index++)
+	{
+		nSum += CTscClock::MonotonicNs() & 1;
+	}
+	uint64 nMonotonic = CTscClock::MonotonicNs() - nBegin;
+	CACHE_LOG(DEBUG_CACHE, "tsc_test NowNs = {} ns MonotonicNs = {} ns sum = {}",
+		nTsc / MAX_TEST_TSC_COUNT, nMonotonic / MAX_TEST_TSC_COUNT, nSum);
+
+	//CLOCK_MONOTONICԱ100ڵƫ
+	uint64 nTscBegin = CTscClock::NowNs();
+	uint64 nMonoBegin = CTscClock::MonotonicNs();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	long long nDrift = (long long)(CTscClock::NowNs() - nTscBegin) - (long long)(CTscClock::MonotonicNs() - nMonoBegin);
+	CACHE_LOG(DEBUG_CACHE, "tsc_test drift in 100ms = {} ns", nDrift);
+
+	//Ǻ뼶ҲͳƵŶӺִкʱ
+	std::atomic<int> count(0);
+	std::atomic<uint64> nQueueCost(0);
+	std::atomic<uint64> nRunCost(0);
+	for (int index = 0; index < MAX_TEST_TSC_TASK; index++)
+	{
+		CTaskHelper<int> task = g_LogicScheduler->Schedule("tsc_test",
+		[index]()
+		{
+			int nValue = 0;
+			for (int loop = 0; loop < 1000; loop++)
+			{
+				nValue += loop * index;
+			}
+			return nValue;
+		});
+		TaskPtr pTask = task.GetTask();
+		task.ThenAccept(g_LogicScheduler,
+		[pTask, &count, &nQueueCost, &nRunCost](int value)
+		{
+			nQueueCost += pTask->GetQueueCost();
+			nRunCost += pTask->GetRunCost();
+			if (++count == MAX_TEST_TSC_TASK)
+			{
+				g_LogicScheduler->StopScheduler();
+			}
+		});
+	}
+	g_LogicScheduler->Init(1);
+	g_LogicScheduler->Join();
+	CACHE_LOG(DEBUG_CACHE, "tsc_test avg queue cost = {} ns avg run cost = {} ns",
+		nQueueCost.load() / MAX_TEST_TSC_TASK, nRunCost.load() / MAX_TEST_TSC_TASK);
+}
+
+#define MAX_TEST_LOG_THREAD 4
+#define MAX_TEST_LOG_COUNT 2000
+
+//ֻ־Ŀ
+class CCountLogSink : public ILogSink
+{
+public:
+	CCountLogSink() : m_nLines(0), m_nBytes(0) {}
+	virtual void Write(int nKind, int nType, const char* pData, size_t nLen)
+	{
+		m_nLines++;
+		m_nBytes += nLen;
+	}
+	virtual void Flush() {}
+public:
+	long long	m_nLines;
+	long long	m_nBytes;
+};
+
+void async_log_test()
+{
+	CCountLogSink sink;
+	CAsyncLog::GetSingletonPtr()->AddSink(&sink);
+	CLogThread::GetSingletonPtr()->StartLog(eLogOverflowBlock);
+
+	//߳ͬʱд־,ͳƵ߳ÿ־ĺʱ(Сڻ,ȴ־߳)
+	std::atomic<long long> nCost(0);
+	std::vector<std::thread> threads;
+	for (int index = 0; index < MAX_TEST_LOG_THREAD; index++)
+	{
+		threads.push_back(std::thread([&nCost, index]()
+		{
+			std::string name = "worker";
+			auto start = std::chrono::steady_clock::now();
+			for (int count = 0; count < MAX_TEST_LOG_COUNT; count++)
+			{
+				CACHE_LOG(DEBUG_CACHE, "async_log_test {} thread = {} count = {}", name, index, count);
+			}
+			nCost += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}));
+	}
+	for (size_t index = 0; index < threads.size(); index++)
+	{
+		threads[index].join();
+	}
+	CLogThread::GetSingletonPtr()->StopLog();
+	CAsyncLog::GetSingletonPtr()->RemoveSink(&sink);
+	//ָֹͣͬ
+	long long nAsync = nCost.load() / (MAX_TEST_LOG_THREAD * MAX_TEST_LOG_COUNT);
+
+	//ͬĺʱ:ʽдļ
+	FILE* pNull = fopen("/dev/null", "w");
+	auto start = std::chrono::steady_clock::now();
+	for (int count = 0; count < MAX_TEST_LOG_COUNT && pNull != NULL; count++)
+	{
+		std::string name = "worker";
+		CLogLine line;
+		detail_log::log_format(line, "[debug] async_log_test {} thread = {} count = {} \n", name, 0, count);
+		fwrite(line.GetData(), 1, line.GetLen(), pNull);
+	}
+	long long nSync = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / MAX_TEST_LOG_COUNT;
+	if (pNull != NULL)
+	{
+		fclose(pNull);
+	}
+	CACHE_LOG(DEBUG_CACHE, "async_log_test async = {} ns sync = {} ns lines = {} ok = {} drop = {}",
+		nAsync, nSync, sink.m_nLines,
+		sink.m_nLines == MAX_TEST_LOG_THREAD * MAX_TEST_LOG_COUNT, CAsyncLog::GetSingletonPtr()->GetDropCount());
+}
+
+#define MAX_TEST_FORMAT_COUNT 1000000
+
+void log_format_test()
+{
+	//64λ޷š㡢ָԭ,ٽضϳlong
+	CLogLine line;
+	detail_log::log_format(line, "u = {} i = {} d = {} b = {} s = {} p = {}",
+		(uint64)18446744073709551615ULL, (int64)(-9223372036854775807LL - 1), 2.5, true, std::string("str"), (void*)0x1f);
+	std::string result(line.GetData(), line.GetLen());
+	CACHE_LOG(DEBUG_CACHE, "log_format_test {} ok = {}", result,
+		result == "u = 18446744073709551615 i = -9223372036854775808 d = 2.5 b = 1 s = str p = 0x1f");
+
+	//ֱӸʽsnprintfĶԱ
+	std::string name = "worker";
+	long long nLen = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int index = 0; index < MAX_TEST_FORMAT_COUNT; index++)
+	{
+		line.Clear();
+		detail_log::log_format(line, "log_format_test {} index = {} value = {}", name, index, (uint64)index * 3);
+		nLen += line.GetLen();
+	}
+	auto direct = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	char szLine[LOG_LINE_SIZE];
+	start = std::chrono::steady_clock::now();
+	for (int index = 0; index < MAX_TEST_FORMAT_COUNT; index++)
+	{
+		nLen -= snprintf(szLine, sizeof(szLine), "log_format_test %s index = %ld value = %llu", name.c_str(), (long)index, (uint64)index * 3);
+	}
+	auto formatted = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	CACHE_LOG(DEBUG_CACHE, "log_format_test direct = {} ns snprintf = {} ns same length = {}",
+		direct / MAX_TEST_FORMAT_COUNT, formatted / MAX_TEST_FORMAT_COUNT, nLen == 0);
+}
+
+#define MAX_TEST_BINARY_COUNT 20000
+#define MAX_TEST_BINARY_BATCH 1000		//һԼ100KB,ŵý̻߳(LOG_RING_SIZE)
+
+//û־߳,дֶ,򻺳дԻһֱȥ;ѵ,nCostۼѺʱ
+int binary_log_round(int nRound, long long& nCost)
+{
+	std::string name = "binary";
+	int nDrain = 0;
+	for (int batch = 0; batch < MAX_TEST_BINARY_COUNT; batch += MAX_TEST_BINARY_BATCH)
+	{
+		for (int count = batch; count < batch + MAX_TEST_BINARY_BATCH; count++)
+		{
+			CACHE_LOG(DEBUG_CACHE, "binary_log_test {} round = {} count = {} value = {}", name, nRound, count, count * 0.5);
+		}
+		auto start = std::chrono::steady_clock::now();
+		nDrain += CAsyncLog::GetSingletonPtr()->Drain();
+		nCost += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+	return nDrain;
+}
+
+void binary_log_test()
+{
+	//־߳,ֶ,ֻȽ־߳ıͶĺʱ
+	CCountLogSink sink;
+	CAsyncLog::GetSingletonPtr()->AddSink(&sink);
+	CAsyncLog::GetSingletonPtr()->SetRunning(true);
+
+	long long text = 0;
+	int nText = binary_log_round(0, text);
+
+	bool bBinary = CAsyncLog::GetSingletonPtr()->EnableBinary("binary_log");
+	long long binary = 0;
+	int nBinary = binary_log_round(1, binary);
+
+	CAsyncLog::GetSingletonPtr()->Flush();
+	CAsyncLog::GetSingletonPtr()->SetRunning(false);
+	CAsyncLog::GetSingletonPtr()->RemoveSink(&sink);
+	//ļtools/log_decoderԭı
+	CACHE_LOG(DEBUG_CACHE, "binary_log_test text = {} ns binary = {} ns bytes = {} ok = {}",
+		text / MAX_TEST_BINARY_COUNT, binary / MAX_TEST_BINARY_COUNT, CAsyncLog::GetSingletonPtr()->GetBinaryBytes(),
+		bBinary && nText == MAX_TEST_BINARY_COUNT && nBinary == MAX_TEST_BINARY_COUNT && sink.m_nLines == MAX_TEST_BINARY_COUNT);
+}
+
+#define MAX_TEST_FILE_LOG_COUNT 1000000
+
+void file_log_test()
+{
+	//4͸дļ,Сת,ͳƴдһеȫдӳ
+	CFileLogSink sink;
+	bool bInit = sink.Init("file_log_test", 64 * 1024 * 1024);
+	CAsyncLog::GetSingletonPtr()->AddSink(&sink);
+	CLogThread::GetSingletonPtr()->StartLog(eLogOverflowBlock);
+
+	std::string name = "worker";
+	auto start = std::chrono::steady_clock::now();
+	for (int count = 0; count < MAX_TEST_FILE_LOG_COUNT; count++)
+	{
+		switch (count & 3)
+		{
+		case 0: CACHE_LOG(DEBUG_CACHE, "file_log_test {} count = {} value = {}", name, count, count * 0.5); break;
+		case 1: CACHE_LOG(ERROR_CACHE, "file_log_test {} count = {} value = {}", name, count, count * 0.5); break;
+		case 2: DISK_LOG(DEBUG_DISK, "file_log_test {} count = {} value = {}", name, count, count * 0.5); break;
+		default: DISK_LOG(ERROR_DISK, "file_log_test {} count = {} value = {}", name, count, count * 0.5); break;
+		}
+	}
+	CLogThread::GetSingletonPtr()->StopLog();
+	auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	CAsyncLog::GetSingletonPtr()->RemoveSink(&sink);
+	sink.Close();
+	CACHE_LOG(DEBUG_CACHE, "file_log_test lines/s = {} files = {} drop = {} ok = {}",
+		(long long)MAX_TEST_FILE_LOG_COUNT * 1000000 / MAX(cost, (long long)1), sink.GetFileCount(), sink.GetDropLines(),
+		bInit && sink.GetDropLines() == 0 && CAsyncLog::GetSingletonPtr()->GetDropCount() == 0);
+}
+
+#define MAX_TEST_LIMIT_COUNT 100000
+#define TEST_LIMIT_RATE 100
+
+class CCaptureLogSink : public ILogSink
+{
+public:
+	virtual void Write(int nKind, int nType, const char* pData, size_t nLen)
+	{
+		m_Lines.push_back(std::string(pData, nLen));
+	}
+	virtual void Flush() {}
+public:
+	std::vector<std::string>	m_Lines;
+};
+
+//ͬһõ
+void log_limit_fail(int count)
+{
+	CACHE_LOG_LIMIT(THREAD_ERROR, TEST_LIMIT_RATE, "log_limit_test Task[{}] execute failed", count);
+}
+
+void log_limit_test()
+{
+	CCaptureLogSink sink;
+	CAsyncLog::GetSingletonPtr()->AddSink(&sink);
+	CAsyncLog::GetSingletonPtr()->SetRunning(true);
+
+	//һͻֻһ,
+	for (int count = 0; count < MAX_TEST_LIMIT_COUNT; count++)
+	{
+		log_limit_fail(count);
+	}
+	CAsyncLog::GetSingletonPtr()->Drain();
+	size_t nBurst = sink.m_Lines.size();
+	//ƻָ,һǰѹ
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	log_limit_fail(0);
+	CAsyncLog::GetSingletonPtr()->Drain();
+	size_t nAfter = sink.m_Lines.size() - nBurst;
+	std::string suppressed = nAfter > 0 ? sink.m_Lines[nBurst] : "";
+
+	//ʱرͺͼ,رպֵ
+	int nEval = 0;
+	CLog::GetSingletonPtr()->EnableCacheLog(DEBUG_CACHE, false);
+	CACHE_LOG(DEBUG_CACHE, "log_limit_test {}", ++nEval);
+	CLog::GetSingletonPtr()->EnableCacheLog(DEBUG_CACHE, true);
+	CLog::GetSingletonPtr()->SetLogLevel(eLogLevelError);
+	CACHE_LOG(DEBUG_CACHE, "log_limit_test {}", ++nEval);
+	bool bErrorOn = CLog::GetSingletonPtr()->IsCacheLogOn(ERROR_CACHE);
+	CLog::GetSingletonPtr()->SetLogLevel(eLogLevelDebug);
+	CAsyncLog::GetSingletonPtr()->Drain();
+	size_t nDisabled = sink.m_Lines.size() - nBurst - nAfter;
+
+	//رʱĿ
+	CLog::GetSingletonPtr()->EnableCacheLog(DEBUG_CACHE, false);
+	std::string name = "worker";
+	auto start = std::chrono::steady_clock::now();
+	for (int count = 0; count < MAX_TEST_LIMIT_COUNT; count++)
+	{
+		CACHE_LOG(DEBUG_CACHE, "log_limit_test {} count = {}", name, count);
+	}
+	auto off = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	CLog::GetSingletonPtr()->EnableCacheLog(DEBUG_CACHE, true);
+
+	CAsyncLog::GetSingletonPtr()->SetRunning(false);
+	CAsyncLog::GetSingletonPtr()->RemoveSink(&sink);
+	//ͻTEST_LIMIT_RATE;ָĵһǰһбѹ;رյͲ
+	CACHE_LOG(DEBUG_CACHE, "log_limit_test burst = {} after = {} off = {} ns ok = {}", nBurst, nAfter, off / MAX_TEST_LIMIT_COUNT,
+		nBurst == TEST_LIMIT_RATE && nAfter == 2 && nDisabled == 0 && nEval == 0 && bErrorOn);
+	CACHE_LOG(DEBUG_CACHE, "log_limit_test {}", suppressed);
+}
+
+#define MAX_TEST_LOCK_THREAD 8
+#define MAX_TEST_LOCK_COUNT 1000000
+
+//nThread߳ͬһ¸ۼMAX_TEST_LOCK_COUNT,ÿμӽƽ,Է-1
+template<typename Lock, typename Guard>
+long long lock_bench(int nThread)
+{
+	Lock lock;
+	long long nCounter = 0;
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (int index = 0; index < nThread; index++)
+	{
+		threads.push_back(std::thread([&lock, &nCounter]()
+		{
+			for (int count = 0; count < MAX_TEST_LOCK_COUNT; count++)
+			{
+				Guard guard(lock);
+				nCounter++;
+			}
+		}));
+	}
+	for (size_t index = 0; index < threads.size(); index++)
+	{
+		threads[index].join();
+	}
+	long long nCost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	if (nCounter != (long long)nThread * MAX_TEST_LOCK_COUNT)
+	{
+		return -1;
+	}
+	return nCost / ((long long)nThread * MAX_TEST_LOCK_COUNT);
+}
+
+void lock_test()
+{
+	for (int nThread = 1; nThread <= MAX_TEST_LOCK_THREAD; nThread *= 2)
+	{
+		CACHE_LOG(DEBUG_CACHE, "lock_test threads = {} CMyLock = {} ns CSpinLock = {} ns CAdaptiveLock = {} ns", nThread,
+			lock_bench<CMyLock, CSafeLock>(nThread),
+			lock_bench<CSpinLock, CSafeSpLock>(nThread),
+			lock_bench<CAdaptiveLock, CSafeAdaptiveLock>(nThread));
+	}
+}
+
+#define MAX_TEST_FAIR_THREAD 16
+#define TEST_FAIR_TIME 200
+
+//nThread߳TEST_FAIR_TIMEͬһ,nOpsΪÿܵļ,fFairΪٺ֮߳(1Ϊȫƽ)
+template<typename Lock, typename Guard>
+void lock_fair_bench(int nThread, long long& nOps, double& fFair)
+{
+	Lock lock;
+	std::atomic_bool bStop(false);
+	std::vector<long long> counts(nThread * 8, 0);
+	long long nShared = 0;
+	std::vector<std::thread> threads;
+	for (int index = 0; index < nThread; index++)
+	{
+		//ÿ̵߳ļһ
+		long long* pCount = &counts[index * 8];
+		threads.push_back(std::thread([&lock, &bStop, &nShared, pCount]()
+		{
+			while (!bStop.load(std::memory_order_relaxed))
+			{
+				Guard guard(lock);
+				nShared++;
+				(*pCount)++;
+			}
+		}));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(TEST_FAIR_TIME));
+	bStop.store(true);
+	for (size_t index = 0; index < threads.size(); index++)
+	{
+		threads[index].join();
+	}
+	long long nMin = counts[0];
+	long long nMax = counts[0];
+	long long nTotal = 0;
+	for (int index = 0; index < nThread; index++)
+	{
+		nMin = MIN(nMin, counts[index * 8]);
+		nMax = MAX(nMax, counts[index * 8]);
+		nTotal += counts[index * 8];
+	}
+	nOps = nTotal == nShared ? nTotal / TEST_FAIR_TIME : -1;
+	fFair = nMax > 0 ? (double)nMin / nMax : 0;
+}
+
+void lock_fair_test()
+{
+	for (int nThread = 2; nThread <= MAX_TEST_FAIR_THREAD; nThread *= 2)
+	{
+		long long nSpinOps = 0, nTicketOps = 0, nMcsOps = 0;
+		double fSpinFair = 0, fTicketFair = 0, fMcsFair = 0;
+		lock_fair_bench<CSpinLock, CSafeSpLock>(nThread, nSpinOps, fSpinFair);
+		lock_fair_bench<CTicketLock, CSafeTicketLock>(nThread, nTicketOps, fTicketFair);
+		lock_fair_bench<CMcsLock, CSafeMcsLock>(nThread, nMcsOps, fMcsFair);
+		CACHE_LOG(DEBUG_CACHE, "lock_fair_test threads = {} ops/ms spin = {} ticket = {} mcs = {} fairness spin = {} ticket = {} mcs = {}",
+			nThread, nSpinOps, nTicketOps, nMcsOps, fSpinFair, fTicketFair, fMcsFair);
+	}
+}
+
+#define MAX_TEST_RW_THREAD 8
+#define MAX_TEST_RW_COUNT 1000000
+
+//д,дÿΰֵһ1,߼
+struct CRWTestData
+{
+	long long	m_nFirst;
+	long long	m_nSecond;
+};
+
+//nThread߸MAX_TEST_RW_COUNT,ͬʱһдÿдһ,ÿζƽ,һµݷ-1
+template<typename Lock, typename RGuard, typename WGuard>
+long long rwlock_bench(int nThread)
+{
+	Lock lock;
+	CRWTestData data = { 0, 0 };
+	std::atomic_bool bStop(false);
+	std::atomic_bool bBroken(false);
+	std::atomic<long long> nCost(0);
+	std::thread writer([&lock, &data, &bStop]()
+	{
+		while (!bStop.load())
+		{
+			{
+				WGuard guard(lock);
+				data.m_nFirst++;
+				data.m_nSecond++;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	std::vector<std::thread> readers;
+	for (int index = 0; index < nThread; index++)
+	{
+		readers.push_back(std::thread([&lock, &data, &bBroken, &nCost]()
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int count = 0; count < MAX_TEST_RW_COUNT; count++)
+			{
+				RGuard guard(lock);
+				if (data.m_nFirst != data.m_nSecond)
+				{
+					bBroken = true;
+				}
+			}
+			nCost += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}));
+	}
+	for (size_t index = 0; index < readers.size(); index++)
+	{
+		readers[index].join();
+	}
+	bStop = true;
+	writer.join();
+	return bBroken ? -1 : nCost.load() / ((long long)nThread * MAX_TEST_RW_COUNT);
+}
+
+void rwlock_test()
+{
+	for (int nThread = 1; nThread <= MAX_TEST_RW_THREAD; nThread *= 2)
+	{
+		CACHE_LOG(DEBUG_CACHE, "rwlock_test readers = {} CSpinRWLock = {} ns CBravoRWLock = {} ns", nThread,
+			rwlock_bench<CSpinRWLock, CSafeSpinRLock, CSafeSpinWLock>(nThread),
+			rwlock_bench<CBravoRWLock, CSafeBravoRLock, CSafeBravoWLock>(nThread));
+	}
+}
+
+//˳Ŀ,дÿдһ,ÿζƽ,һµݷ-1
+long long seqlock_bench(int nThread)
+{
+	CSeqLock<CRWTestData> lock;
+	std::atomic_bool bStop(false);
+	std::atomic_bool bBroken(false);
+	std::atomic<long long> nCost(0);
+	std::thread writer([&lock, &bStop]()
+	{
+		CRWTestData data = { 0, 0 };
+		while (!bStop.load())
+		{
+			data.m_nFirst++;
+			data.m_nSecond++;
+			lock.Write(data);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	std::vector<std::thread> readers;
+	for (int index = 0; index < nThread; index++)
+	{
+		readers.push_back(std::thread([&lock, &bBroken, &nCost]()
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int count = 0; count < MAX_TEST_RW_COUNT; count++)
+			{
+				CRWTestData data = lock.Read();
+				if (data.m_nFirst != data.m_nSecond)
+				{
+					bBroken = true;
+				}
+			}
+			nCost += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}));
+	}
+	for (size_t index = 0; index < readers.size(); index++)
+	{
+		readers[index].join();
+	}
+	bStop = true;
+	writer.join();
+	return bBroken ? -1 : nCost.load() / ((long long)nThread * MAX_TEST_RW_COUNT);
+}
+
+//RCU,ʱ,оɶ󶼱ͷ
+std::atomic<long long> g_nRcuDataDeleted(0);
+struct CRcuTestData : public CRWTestData
+{
+	~CRcuTestData()		{ g_nRcuDataDeleted++; }
+};
+
+//ÿ64ζһֹ,дÿ뷢һ,ÿζƽ,һµݷ-1
+long long rcu_bench(int nThread, long long& nPublish)
+{
+	CRcuPtr<CRcuTestData> ptr(new CRcuTestData());
+	std::atomic_bool bStop(false);
+	std::atomic_bool bBroken(false);
+	std::atomic<long long> nCost(0);
+	nPublish = 0;
+	std::thread writer([&ptr, &bStop, &nPublish]()
+	{
+		while (!bStop.load())
+		{
+			CRcuTestData* pData = new CRcuTestData(*ptr.Read());
+			pData->m_nFirst++;
+			pData->m_nSecond++;
+			ptr.Publish(pData);
+			nPublish++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	std::vector<std::thread> readers;
+	for (int index = 0; index < nThread; index++)
+	{
+		readers.push_back(std::thread([&ptr, &bBroken, &nCost]()
+		{
+			CRcu::GetSingletonPtr()->RegisterThread();
+			auto start = std::chrono::steady_clock::now();
+			for (int count = 0; count < MAX_TEST_RW_COUNT; count++)
+			{
+				{
+					CRcuReadGuard<CRcuTestData> guard(ptr);
+					if (guard->m_nFirst != guard->m_nSecond)
+					{
+						bBroken = true;
+					}
+				}
+				if ((count & 63) == 0)
+				{
+					CRcu::GetSingletonPtr()->Quiescent();
+				}
+			}
+			nCost += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			CRcu::GetSingletonPtr()->UnregisterThread();
+		}));
+	}
+	for (size_t index = 0; index < readers.size(); index++)
+	{
+		readers[index].join();
+	}
+	bStop = true;
+	writer.join();
+	return bBroken ? -1 : nCost.load() / ((long long)nThread * MAX_TEST_RW_COUNT);
+}
+
+void rcu_test()
+{
+	for (int nThread = 1; nThread <= MAX_TEST_RW_THREAD; nThread *= 2)
+	{
+		long long nPublish = 0;
+		g_nRcuDataDeleted = 0;
+		long long nSeqCost = seqlock_bench(nThread);
+		long long nRcuCost = rcu_bench(nThread, nPublish);
+		//߶ע,ʣµľɶȫͷ
+		CRcu::GetSingletonPtr()->Reclaim();
+		CACHE_LOG(DEBUG_CACHE, "rcu_test readers = {} CSeqLock = {} ns CRcuPtr = {} ns publish = {} reclaimed = {} pending = {}", nThread,
+			nSeqCost, nRcuCost, nPublish, g_nRcuDataDeleted.load(), CRcu::GetSingletonPtr()->GetPendingCount());
+	}
+}
+
+//һһżõһѶд,Ӧڱǰ;Ҫ-DLOCK_PROFILE
+void lock_profile_test()
+{
+#if defined(LOCK_PROFILE_ON)
+	CMyLock hotLock("lock_profile_test.hot");
+	CSpinLock coldLock("lock_profile_test.cold");
+	CSpinRWLock rwLock("lock_profile_test.rw");
+	long long nCount = 0;
+	std::vector<std::thread> threads;
+	for (int index = 0; index < 4; index++)
+	{
+		threads.push_back(std::thread([&hotLock, &coldLock, &rwLock, &nCount]()
+		{
+			for (int count = 0; count < MAX_TEST_COUNT * 10; count++)
+			{
+				{
+					CSafeLock guard(hotLock);
+					nCount++;
+				}
+				if (count % 100 == 0)
+				{
+					CSafeSpLock guard(coldLock);
+				}
+				CSafeSpinRLock guard(rwLock);
+			}
+		}));
+	}
+	for (size_t index = 0; index < threads.size(); index++)
+	{
+		threads[index].join();
+	}
+	CLockProfile::GetSingletonPtr()->LogReport();
+#else
+	CACHE_LOG(DEBUG_CACHE, "lock_profile_test needs -DLOCK_PROFILE");
+#endif
+}
+
+#define MAX_TEST_STRAND 1000
+#define MAX_TEST_STRAND_TASK 100
+#define MAX_TEST_STRAND_THREAD 4
+
+//ÿstrand񰴱żִ˳,ͬʱû߳ͬʱִͬһstrand
+struct CStrandTestData
+{
+	CStrandTestData() : m_nNext(0), m_bRunning(false), m_bBroken(false) {}
+	int					m_nNext;
+	std::atomic_bool	m_bRunning;
+	bool				m_bBroken;
+};
+
+void strand_test()
+{
+	CSafePtr<CThreadScheduler> pPool = new CThreadScheduler("StrandPool");
+	if (!pPool->Init(MAX_TEST_STRAND_THREAD))
+	{
+		return;
+	}
+	std::vector<CSafePtr<CStrandScheduler>> strands;
+	std::vector<CStrandTestData> dataList(MAX_TEST_STRAND);
+	for (int index = 0; index < MAX_TEST_STRAND; index++)
+	{
+		strands.push_back(new CStrandScheduler("TestStrand", pPool));
+	}
+	std::atomic_int nDone(0);
+	uint64 nStart = CTscClock::NowNs();
+	for (int count = 0; count < MAX_TEST_STRAND_TASK; count++)
+	{
+		for (int index = 0; index < MAX_TEST_STRAND; index++)
+		{
+			CStrandTestData* pData = &dataList[index];
+			strands[index]->Schedule("strand_test",
+				[pData, count, &nDone]()
+				{
+					if (pData->m_bRunning.exchange(true) || pData->m_nNext != count)
+					{
+						pData->m_bBroken = true;
+					}
+					pData->m_nNext++;
+					pData->m_bRunning.store(false);
+					nDone++;
+				});
+		}
+	}
+	while (nDone.load() < MAX_TEST_STRAND * MAX_TEST_STRAND_TASK)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	uint64 nCost = CTscClock::NowNs() - nStart;
+	int nBroken = 0;
+	for (int index = 0; index < MAX_TEST_STRAND; index++)
+	{
+		if (dataList[index].m_bBroken || dataList[index].m_nNext != MAX_TEST_STRAND_TASK)
+		{
+			nBroken++;
+		}
+	}
+	pPool->StopScheduler();
+	pPool->Join();
+	for (int index = 0; index < MAX_TEST_STRAND; index++)
+	{
+		strands[index].Free();
+	}
+	CACHE_LOG(DEBUG_CACHE, "strand_test strands = {} threads = {} tasks = {} cost = {} ms broken = {}",
+		MAX_TEST_STRAND, MAX_TEST_STRAND_THREAD, nDone.load(), nCost / 1000000, nBroken);
+}
+
+#define MAX_TEST_SHARD_KEY 1000
+#define MAX_TEST_SHARD_GUILD 10
+
+//keyϰż˳,֮ThenAcceptkeyϲۼӷ;ٸһƬȵ,ƽ˳
+void sharded_test()
+{
+	CSafePtr<CThreadScheduler> pPool = new CThreadScheduler("ShardPool");
+	if (!pPool->Init(MAX_TEST_STRAND_THREAD))
+	{
+		return;
+	}
+	CSafePtr<CShardedScheduler> pSharded = new CShardedScheduler("TestShard", pPool, 16);
+	std::vector<CStrandTestData> players(MAX_TEST_SHARD_KEY);
+	std::vector<int> guildScores(MAX_TEST_SHARD_GUILD, 0);
+	std::atomic_int nDone(0);
+	int nTotal = 0;
+	for (int count = 0; count < MAX_TEST_STRAND_TASK; count++)
+	{
+		for (int index = 0; index < MAX_TEST_SHARD_KEY; index++)
+		{
+			CStrandTestData* pData = &players[index];
+			int* pGuildScore = &guildScores[index % MAX_TEST_SHARD_GUILD];
+			//keykey
+			uint64 nGuildKey = MAX_TEST_SHARD_KEY + index % MAX_TEST_SHARD_GUILD;
+			pSharded->Schedule(index,
+				[pData, count]()
+				{
+					if (pData->m_bRunning.exchange(true) || pData->m_nNext != count)
+					{
+						pData->m_bBroken = true;
+					}
+					pData->m_nNext++;
+					pData->m_bRunning.store(false);
+					return 1;
+				}).ThenAccept(nGuildKey,
+				[pGuildScore, &nDone](int score)
+				{
+					*pGuildScore += score;
+					nDone++;
+				});
+			nTotal++;
+		}
+		//ֻƬ0ϵͶ,ȵ
+		if (count == MAX_TEST_STRAND_TASK / 2)
+		{
+			while (nDone.load() < nTotal)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			//÷ȵ,ִ֮ƱҲҪ黹,keyŲ
+			std::vector<CShardedTaskHelper<void>> hotTasks;
+			for (int index = 0; index < MAX_TEST_SHARD_KEY; index++)
+			{
+				if (pSharded->GetHomeShard(index) == 0)
+				{
+					for (int extra = 0; extra < MAX_TEST_STRAND_TASK * 5; extra++)
+					{
+						hotTasks.push_back(pSharded->Schedule(index, [&nDone]() { nDone++; }));
+						nTotal++;
+					}
+				}
+			}
+			//ȵϵִ,keyŲ
+			while (nDone.load() < nTotal)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			CACHE_LOG(DEBUG_CACHE, "sharded_test rebalance moved = {}", pSharded->Rebalance());
+		}
+	}
+	while (nDone.load() < nTotal)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	int nBroken = 0;
+	for (int index = 0; index < MAX_TEST_SHARD_KEY; index++)
+	{
+		if (players[index].m_bBroken || players[index].m_nNext != MAX_TEST_STRAND_TASK)
+		{
+			nBroken++;
+		}
+	}
+	int nScore = 0;
+	for (int index = 0; index < MAX_TEST_SHARD_GUILD; index++)
+	{
+		nScore += guildScores[index];
+	}
+	pPool->StopScheduler();
+	pPool->Join();
+	pSharded.Free();
+	CACHE_LOG(DEBUG_CACHE, "sharded_test keys = {} tasks = {} guild score = {} broken = {}", MAX_TEST_SHARD_KEY, nTotal, nScore, nBroken);
+}
+
+#define MAX_TEST_BUDGET_TASK 1000
+#define MAX_TEST_BUDGET_HIGH 10
+#define TEST_BUDGET_TASKS 100
+#define TEST_BUDGET_RESERVE 20
+//ģⳡִ֡,ÿִ֡TEST_BUDGET_TASKS,ԤTEST_BUDGET_RESERVE%ȼ
+void budget_test()
+{
+	CSafePtr<CTaskScheduler> pScene = new CTaskScheduler("BudgetScene");
+	pScene->SetPriorityReserve(TEST_BUDGET_RESERVE);
+	int nNormalDone = 0;
+	int nHighDone = 0;
+	int nHighFrame = -1;
+	int nFrame = 0;
+	for (int index = 0; index < MAX_TEST_BUDGET_TASK; index++)
+	{
+		pScene->Schedule("budget_normal", [&nNormalDone]() { nNormalDone++; });
+	}
+	int nCarryOver = pScene->ConsumeTask(TEST_BUDGET_TASKS, 0);
+	nFrame++;
+	//ѹ֮ĸȼͨ,һִ֡
+	for (int index = 0; index < MAX_TEST_BUDGET_HIGH; index++)
+	{
+		pScene->SchedulePriority("budget_high",
+			[&nHighDone, &nHighFrame, &nFrame]()
+			{
+				nHighDone++;
+				nHighFrame = nFrame;
+			});
+	}
+	while (nCarryOver > 0)
+	{
+		nCarryOver = pScene->ConsumeTask(TEST_BUDGET_TASKS, 0);
+		nFrame++;
+	}
+	//ֻʱԤ,ÿ֡1
+	for (int index = 0; index < MAX_TEST_BUDGET_TASK; index++)
+	{
+		pScene->Schedule("budget_time", []() { std::this_thread::sleep_for(std::chrono::microseconds(100)); });
+	}
+	int nTimeFrame = 0;
+	while (pScene->ConsumeTask(0, 1000) > 0)
+	{
+		nTimeFrame++;
+	}
+	CACHE_LOG(DEBUG_CACHE, "budget_test normal = {} high = {} frames = {} high done frame = {} time frames = {} carry over ticks = {}",
+		nNormalDone, nHighDone, nFrame, nHighFrame, nTimeFrame, pScene->GetCarryOverTicks());
+	pScene.Free();
+}
+
+#define TEST_TICK_RATE 60
+#define TEST_TICK_TIME 2000
+//60֡߳,ÿһʱһγʱ,ͬʱͶ,֡϶ִԼ׷֡Եͳ
+void tick_test_policy(enTickCatchUp eCatchUp)
+{
+	CSafePtr<CThreadScheduler> pScheduler = new CThreadScheduler("TickScheduler");
+	pScheduler->SetTickRate(TEST_TICK_RATE, eCatchUp);
+	std::atomic_int nTick(0);
+	if (!pScheduler->Init(1, NULL,
+		[&nTick](void*)
+		{
+			//ÿ30֡һ֡ʱ֡
+			if (++nTick % 30 == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(2500 / TEST_TICK_RATE));
+			}
+		}))
+	{
+		return;
+	}
+	std::atomic_int nDone(0);
+	int nTotal = 0;
+	uint64 nEnd = CTscClock::NowMs() + TEST_TICK_TIME;
+	while (CTscClock::NowMs() < nEnd)
+	{
+		pScheduler->Schedule("tick_test", [&nDone]() { nDone++; });
+		nTotal++;
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+	while (nDone.load() < nTotal)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CTickStat stat = pScheduler->GetTickStat(0);
+	pScheduler->StopScheduler();
+	pScheduler->Join();
+	CACHE_LOG(DEBUG_CACHE, "tick_test policy = {} frames = {} overruns = {} skipped = {} catch up = {} avg jitter = {} ns max jitter = {} ns tasks = {}",
+		(int)eCatchUp, stat.m_nFrames, stat.m_nOverruns, stat.m_nSkippedFrames, stat.m_nCatchUpFrames,
+		stat.m_nJitterSamples > 0 ? stat.m_nTotalJitterNs / stat.m_nJitterSamples : 0, stat.m_nMaxJitterNs, nDone.load());
+	pScheduler.Free();
+}
+
+void tick_test()
+{
+	tick_test_policy(eTickCatchUpSkip);
+	tick_test_policy(eTickCatchUpBurst);
+	tick_test_policy(eTickCatchUpReset);
+}
+
+#define TEST_QUEUE_CAPACITY 100
+#define TEST_QUEUE_PUSH 1000
+//̵߳ĵͶݳִ,ܾ÷ִСֲ;һĹ߳
+void queue_test_policy(enQueueOverflow ePolicy)
+{
+	CSafePtr<CTaskScheduler> pScheduler = new CTaskScheduler("QueueScheduler");
+	pScheduler->SetQueueCapacity(TEST_QUEUE_CAPACITY, ePolicy);
+	int nHighWater = 0;
+	pScheduler->SetHighWaterMark(TEST_QUEUE_CAPACITY * 8 / 10, [&nHighWater](CTaskScheduler*, size_t) { nHighWater++; });
+	int nDone = 0;
+	std::vector<TaskPtr> taskList;
+	for (int index = 0; index < TEST_QUEUE_PUSH; index++)
+	{
+		taskList.push_back(pScheduler->Schedule("queue_test", [&nDone]() { nDone++; }).GetTask());
+	}
+	pScheduler->ConsumeTask();
+	int nFailed = 0;
+	for (size_t index = 0; index < taskList.size(); index++)
+	{
+		if (taskList[index]->GetState() == enTaskState::eTaskFailed)
+		{
+			nFailed++;
+		}
+	}
+	CACHE_LOG(DEBUG_CACHE, "queue_test policy = {} done = {} failed = {} rejected = {} caller runs = {} shed = {} high water = {}",
+		(int)ePolicy, nDone, nFailed, pScheduler->GetOverflowCount(eQueueOverflowReject), pScheduler->GetOverflowCount(eQueueOverflowCallerRuns),
+		pScheduler->GetOverflowCount(eQueueOverflowShed), nHighWater);
+	pScheduler.Free();
+}
+
+void queue_block_test()
+{
+	CSafePtr<CThreadScheduler> pScheduler = new CThreadScheduler("QueueBlockScheduler");
+	pScheduler->SetQueueCapacity(TEST_QUEUE_CAPACITY, eQueueOverflowBlock);
+	if (!pScheduler->Init(1))
+	{
+		return;
+	}
+	std::atomic_int nDone(0);
+	//ÿͶ֮г,²ܳ
+	size_t nMaxSize = 0;
+	for (int index = 0; index < TEST_QUEUE_PUSH; index++)
+	{
+		pScheduler->Schedule("queue_block_test",
+			[&nDone]()
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				nDone++;
+			});
+		nMaxSize = MAX(nMaxSize, pScheduler->GetQueueSize());
+	}
+	while (nDone.load() < TEST_QUEUE_PUSH)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	pScheduler->StopScheduler();
+	pScheduler->Join();
+	CACHE_LOG(DEBUG_CACHE, "queue_block_test done = {} blocked = {} max size = {} ok = {}", nDone.load(),
+		pScheduler->GetOverflowCount(eQueueOverflowBlock), nMaxSize, nMaxSize <= TEST_QUEUE_CAPACITY);
+	pScheduler.Free();
+}
+
+#define TEST_QUEUE_STRAND 10
+#define TEST_QUEUE_STRAND_TASK 100
+#define TEST_QUEUE_PARALLEL 1000
+//Ϊ1̳߳strandParallelFor,strandִκͲ鲻,Ϊܾ߶ס
+//̳߳ûй߳,ڵǰִ߳Ķ
+void queue_strand_test(enQueueOverflow ePolicy)
+{
+	CSafePtr<CThreadScheduler> pPool = new CThreadScheduler("QueueStrandPool");
+	pPool->SetQueueCapacity(1, ePolicy);
+	std::vector<CSafePtr<CStrandScheduler>> strands;
+	for (int index = 0; index < TEST_QUEUE_STRAND; index++)
+	{
+		strands.push_back(new CStrandScheduler("QueueStrand", pPool, 1));
+	}
+	int nDone = 0;
+	for (int count = 0; count < TEST_QUEUE_STRAND_TASK; count++)
+	{
+		for (int index = 0; index < TEST_QUEUE_STRAND; index++)
+		{
+			strands[index]->Schedule("queue_strand_test", [&nDone]() { nDone++; });
+		}
+	}
+	int nParallel = 0;
+	CTaskHelper<void> parallel = pPool->ParallelFor(CIndexRange(0, TEST_QUEUE_PARALLEL), TEST_QUEUE_PARALLEL / 10,
+		[&nParallel](size_t index)
+		{
+			nParallel++;
+		});
+	while (pPool->GetQueueSize() > 0)
+	{
+		pPool->ConsumeTask();
+	}
+	int nScheduled = 0;
+	for (int index = 0; index < TEST_QUEUE_STRAND; index++)
+	{
+		if (strands[index]->IsScheduled())
+		{
+			nScheduled++;
+		}
+		strands[index].Free();
+	}
+	bool bOk = nDone == TEST_QUEUE_STRAND * TEST_QUEUE_STRAND_TASK && nParallel == TEST_QUEUE_PARALLEL
+		&& parallel.GetTask()->GetState() == enTaskState::eTaskDone && nScheduled == 0;
+	CACHE_LOG(DEBUG_CACHE, "queue_strand_test policy = {} done = {} parallel = {} scheduled = {} ok = {}",
+		(int)ePolicy, nDone, nParallel, nScheduled, bOk);
+	pPool.Free();
+}
+
+void queue_test()
+{
+	queue_test_policy(eQueueOverflowReject);
+	queue_test_policy(eQueueOverflowCallerRuns);
+	queue_test_policy(eQueueOverflowShed);
+	queue_block_test();
+	for (int index = 0; index < eQueueOverflowCount; index++)
+	{
+		queue_strand_test((enQueueOverflow)index);
+	}
+}
+
 void main()
 {
 	//schedler_test();
+	//parallel_test();
+	//parallel_throw_test();
+	//when_all_test();
+	//accept_any_test();
+	//hedged_test();
+	//hedged_void_test();
+	//footprint_test();
+	//safe_ptr_test();
+	//clock_test();
+	//tsc_test();
+	//async_log_test();
+	//log_format_test();
+	//binary_log_test();
+	//file_log_test();
+	//log_limit_test();
+	//lock_test();
+	//lock_fair_test();
+	//rwlock_test();
+	//rcu_test();
+	//lock_profile_test();
+	//strand_test();
+	//sharded_test();
+	//budget_test();
+	//tick_test();
+	//queue_test();
 	scene_test();
     getchar();
 }
@@ -0,0 +1,149 @@
+/*****************************************************************
+* FileName:log_decoder.cpp
+* Summary :־ν빤,÷: log_decoder ļ...
+* Date	  :2026-10-18
+* Author  :DGuco(1139140929@qq.com)
+******************************************************************/
+#include <map>
+#include <vector>
+#include <string>
+#include <ctime>
+#include "log.h"
+#include "time_helper.h"
+
+//ĵõ㶨
+struct CDecodeSite
+{
+	CDecodeSite() : m_nLine(0) {}
+	std::string		m_Format;
+	std::string		m_File;
+	int64			m_nLine;
+};
+
+static bool ReadFile(const char* pPath, std::vector<char>& data)
+{
+	FILE* pFile = fopen(pPath, "rb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+	char szBuffer[64 * 1024];
+	size_t nRead = 0;
+	while ((nRead = fread(szBuffer, 1, sizeof(szBuffer), pFile)) > 0)
+	{
+		data.insert(data.end(), szBuffer, szBuffer + nRead);
+	}
+	fclose(pFile);
+	return true;
+}
+
+//õ㶨Ϊʽļк,Խ¼ĩβʱĲٶ
+static void DecodeSite(const CLogRecord* pRecord, CDecodeSite& site)
+{
+	const char* pArg = (const char*)pRecord + sizeof(CLogRecord);
+	const char* pEnd = (const char*)pRecord + pRecord->m_nSize;
+	for (int index = 0; index < pRecord->m_nArgCount && index < 3; index++)
+	{
+		const char* pData = pArg + sizeof(CLogArgHeader);
+		const CLogArgHeader* pHeader = detail_log::log_next_arg(pArg, pEnd);
+		if (pHeader == NULL)
+		{
+			break;
+		}
+		if (index == 0)
+		{
+			site.m_Format.assign(pData, pHeader->m_nLen);
+		}
+		else if (index == 1)
+		{
+			site.m_File.assign(pData, pHeader->m_nLen);
+		}
+		else if (pHeader->m_nType != eLogArgString)
+		{
+			memcpy(&site.m_nLine, pData, sizeof(int64));
+		}
+	}
+}
+
+//ʱ [߳] [־] 
+static void DecodeRecord(const CLogRecord* pRecord, const std::map<uint32, CDecodeSite>& sites, CLogLine& line)
+{
+	line.Clear();
+	time_t nSecond = (time_t)(pRecord->m_nTime / 1000000);
+	std::tm tm = CTimeHelper::LocalTime(nSecond);
+	char szTime[64];
+	int nLen = snprintf(szTime, sizeof(szTime), "%04d-%02d-%02d %02d:%02d:%02d.%06u ",
+		tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (uint32)(pRecord->m_nTime % 1000000));
+	line.Append(szTime, nLen);
+	detail_log::log_format(line, "[{}] [{}] ", pRecord->m_nThread, CAsyncLog::GetLogName(pRecord->m_nKind, pRecord->m_nType));
+	std::map<uint32, CDecodeSite>::const_iterator it = sites.find(pRecord->m_nSiteId);
+	if (it == sites.end())
+	{
+		detail_log::log_format(line, "<unknown log site {}>", pRecord->m_nSiteId);
+	}
+	else
+	{
+		CAsyncLog::FormatRecord(pRecord, it->second.m_Format.c_str(), line);
+	}
+	line.Append("\n", 1);
+}
+
+static int DecodeSegment(const char* pPath)
+{
+	std::vector<char> data;
+	if (!ReadFile(pPath, data))
+	{
+		fprintf(stderr, "open %s failed\n", pPath);
+		return -1;
+	}
+	const CLogSegmentHeader* pHeader = (const CLogSegmentHeader*)data.data();
+	if (data.size() < sizeof(CLogSegmentHeader) || memcmp(pHeader->m_szMagic, LOG_SEGMENT_MAGIC, sizeof(pHeader->m_szMagic)) != 0
+		|| pHeader->m_nVersion != LOG_SEGMENT_VERSION)
+	{
+		fprintf(stderr, "%s is not a log segment\n", pPath);
+		return -1;
+	}
+	std::map<uint32, CDecodeSite> sites;
+	CLogLine line;
+	int nCount = 0;
+	size_t nPos = pHeader->m_nHeaderSize;
+	//ûرյĶβԤ0
+	while (nPos + sizeof(CLogRecord) <= data.size())
+	{
+		const CLogRecord* pRecord = (const CLogRecord*)(data.data() + nPos);
+		if (pRecord->m_nSize < sizeof(CLogRecord) || nPos + pRecord->m_nSize > data.size())
+		{
+			break;
+		}
+		if (pRecord->m_nKind == eLogRecordFormat)
+		{
+			DecodeSite(pRecord, sites[pRecord->m_nSiteId]);
+		}
+		else
+		{
+			DecodeRecord(pRecord, sites, line);
+			fwrite(line.GetData(), 1, line.GetLen(), stdout);
+			nCount++;
+		}
+		nPos += pRecord->m_nSize;
+	}
+	return nCount;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s segment%s...\n", argv[0], LOG_SEGMENT_SUFFIX);
+		return 1;
+	}
+	int nRet = 0;
+	for (int index = 1; index < argc; index++)
+	{
+		if (DecodeSegment(argv[index]) < 0)
+		{
+			nRet = 1;
+		}
+	}
+	return nRet;
+}